@@ -0,0 +1,208 @@
+#include "curve.h"
+
+#include "parallel.h"
+#include "profiling.h"
+#include "sessionrecording.h"
+#include <cmath>
+
+namespace {
+    // The filters are cheap per value, so segments should not be too small
+    constexpr const size_t MinimumSegmentSize = 16384;
+
+    std::vector<double> filterWeights(Filter filter, int radius) {
+        std::vector<double> weights(2 * radius + 1, 1.0);
+        if (filter == Filter::Gaussian) {
+            // The window covers two standard deviations to each side
+            const double sigma = std::max(radius / 2.0, 0.5);
+            for (int i = -radius; i <= radius; i += 1) {
+                weights[i + radius] = std::exp(-(i * i) / (2.0 * sigma * sigma));
+            }
+        }
+        return weights;
+    }
+} // namespace
+
+const char* channelName(Channel channel) {
+    switch (channel) {
+        case Channel::PositionX: return "Position X";
+        case Channel::PositionY: return "Position Y";
+        case Channel::PositionZ: return "Position Z";
+        case Channel::OrientationW: return "Orientation W";
+        case Channel::OrientationX: return "Orientation X";
+        case Channel::OrientationY: return "Orientation Y";
+        case Channel::OrientationZ: return "Orientation Z";
+        case Channel::Scale: return "Scale";
+    }
+    return "";
+}
+
+bool isOrientationChannel(Channel channel) {
+    return channel == Channel::OrientationW || channel == Channel::OrientationX ||
+        channel == Channel::OrientationY || channel == Channel::OrientationZ;
+}
+
+double channelValue(const KeyframeCamera* kf, Channel channel) {
+    switch (channel) {
+        case Channel::PositionX: return kf->posX;
+        case Channel::PositionY: return kf->posY;
+        case Channel::PositionZ: return kf->posZ;
+        case Channel::OrientationW: return kf->orientationW;
+        case Channel::OrientationX: return kf->orientationX;
+        case Channel::OrientationY: return kf->orientationY;
+        case Channel::OrientationZ: return kf->orientationZ;
+        case Channel::Scale: return kf->scale;
+    }
+    return 0.0;
+}
+
+void setChannelValue(KeyframeCamera* kf, Channel channel, double value) {
+    switch (channel) {
+        case Channel::PositionX: kf->posX = value; break;
+        case Channel::PositionY: kf->posY = value; break;
+        case Channel::PositionZ: kf->posZ = value; break;
+        case Channel::OrientationW: kf->orientationW = value; break;
+        case Channel::OrientationX: kf->orientationX = value; break;
+        case Channel::OrientationY: kf->orientationY = value; break;
+        case Channel::OrientationZ: kf->orientationZ = value; break;
+        case Channel::Scale: kf->scale = value; break;
+    }
+}
+
+double ChannelCurve::normalize(double value) const {
+    // Constant channels are shown with a unit range instead of dividing by zero
+    double range = minMax.second > minMax.first ? minMax.second - minMax.first : 1.0;
+    return (value - minMax.first) / range;
+}
+
+double ChannelCurve::denormalize(double y) const {
+    double range = minMax.second > minMax.first ? minMax.second - minMax.first : 1.0;
+    return minMax.first + y * range;
+}
+
+ChannelCurve createChannelCurve(std::vector<double> values, const std::vector<double>& x) {
+    assert(values.size() == x.size());
+
+    ChannelCurve res;
+    res.values = std::move(values);
+    if (res.values.empty())  return res;
+
+    std::pair<std::vector<double>::const_iterator, std::vector<double>::const_iterator> mm =
+        std::minmax_element(res.values.begin(), res.values.end());
+    res.minMax = std::pair(*mm.first, *mm.second);
+
+    // remove keyframes that are represented by linear interpolation. The comparison is
+    // always against the last value that was kept, so we can compact in a single pass
+    const std::vector<double>& v = res.values;
+    std::vector<size_t>& linearized = res.linearized;
+    linearized.push_back(0);
+    for (size_t i = 1; i + 1 < v.size(); i += 1) {
+        const size_t before = linearized.back();
+        const size_t after = i + 1;
+        const double beforeY = res.normalize(v[before]);
+        const double currentY = res.normalize(v[i]);
+        const double afterY = res.normalize(v[after]);
+
+        double t = (x[i] - x[before]) / (x[after] - x[before]);
+        double y = beforeY + t * (afterY - beforeY);
+
+        constexpr const double Epsilon = 1e-4;
+        if (std::abs(y - currentY) > Epsilon && (afterY != beforeY)) {
+            linearized.push_back(i);
+        }
+    }
+    if (v.size() > 1)  linearized.push_back(v.size() - 1);
+    addToCounter(Counter::CurvePointsSimplified, v.size() - linearized.size());
+
+    return res;
+}
+
+std::vector<double> filterValues(const std::vector<double>& values, Filter filter,
+                                 int radius)
+{
+    ScopedTimer timer("filterValues");
+    if (radius <= 0)  return values;
+
+    const std::vector<double> weights = filterWeights(filter, radius);
+    const long long n = static_cast<long long>(values.size());
+    std::vector<double> res(values.size());
+    parallelForChunks(values.size(), parallelChunkCount(values.size(), MinimumSegmentSize),
+        [&](size_t, size_t begin, size_t end) {
+            for (long long i = static_cast<long long>(begin);
+                 i < static_cast<long long>(end); i += 1)
+            {
+                const long long first = std::max(i - radius, 0LL);
+                const long long last = std::min(i + radius, n - 1);
+
+                double sum = 0.0;
+                double weightSum = 0.0;
+                for (long long j = first; j <= last; j += 1) {
+                    double w = weights[j - i + radius];
+                    sum += w * values[j];
+                    weightSum += w;
+                }
+                res[i] = sum / weightSum;
+            }
+        }
+    );
+    return res;
+}
+
+std::array<std::vector<double>, 4> filterOrientation(
+    const std::array<const std::vector<double>*, 4>& orientation, Filter filter,
+    int radius)
+{
+    ScopedTimer timer("filterOrientation");
+    const std::vector<double>& qw = *orientation[0];
+    const std::vector<double>& qx = *orientation[1];
+    const std::vector<double>& qy = *orientation[2];
+    const std::vector<double>& qz = *orientation[3];
+    if (radius <= 0)  return { qw, qx, qy, qz };
+
+    const std::vector<double> weights = filterWeights(filter, radius);
+    const long long n = static_cast<long long>(qw.size());
+    std::array<std::vector<double>, 4> res;
+    for (std::vector<double>& r : res) {
+        r.resize(qw.size());
+    }
+
+    parallelForChunks(qw.size(), parallelChunkCount(qw.size(), MinimumSegmentSize),
+        [&](size_t, size_t begin, size_t end) {
+            for (long long i = static_cast<long long>(begin);
+                 i < static_cast<long long>(end); i += 1)
+            {
+                const long long first = std::max(i - radius, 0LL);
+                const long long last = std::min(i + radius, n - 1);
+
+                double w = 0.0;
+                double x = 0.0;
+                double y = 0.0;
+                double z = 0.0;
+                for (long long j = first; j <= last; j += 1) {
+                    // q and -q are the same rotation, so all neighbors have to be on the
+                    // same side as the center before they can be averaged
+                    double dot = qw[i] * qw[j] + qx[i] * qx[j] + qy[i] * qy[j] +
+                        qz[i] * qz[j];
+                    double weight = weights[j - i + radius] * (dot < 0.0 ? -1.0 : 1.0);
+                    w += weight * qw[j];
+                    x += weight * qx[j];
+                    y += weight * qy[j];
+                    z += weight * qz[j];
+                }
+
+                double length = std::sqrt(w * w + x * x + y * y + z * z);
+                if (length == 0.0) {
+                    w = qw[i];
+                    x = qx[i];
+                    y = qy[i];
+                    z = qz[i];
+                    length = 1.0;
+                }
+                res[0][i] = w / length;
+                res[1][i] = x / length;
+                res[2][i] = y / length;
+                res[3][i] = z / length;
+            }
+        }
+    );
+    return res;
+}
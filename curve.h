@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+struct KeyframeCamera;
+
+enum class Channel {
+    PositionX = 0,
+    PositionY,
+    PositionZ,
+    OrientationW,
+    OrientationX,
+    OrientationY,
+    OrientationZ,
+    Scale
+};
+constexpr const size_t NumberOfChannels = 8;
+
+const char* channelName(Channel channel);
+bool isOrientationChannel(Channel channel);
+
+double channelValue(const KeyframeCamera* kf, Channel channel);
+void setChannelValue(KeyframeCamera* kf, Channel channel, double value);
+
+// The values of a single channel for all camera keyframes of a recording
+struct ChannelCurve {
+    // Maps between channel values and the normalized [0, 1] range that is displayed
+    double normalize(double value) const;
+    double denormalize(double y) const;
+
+    std::vector<double> values;
+    std::pair<double, double> minMax;
+
+    // Indices of the values that are not represented by linear interpolation between
+    // their neighbors
+    std::vector<size_t> linearized;
+};
+
+// Creates the curve from the values and the normalized times of the keyframes
+ChannelCurve createChannelCurve(std::vector<double> values, const std::vector<double>& x);
+
+enum class Filter { Gaussian, MovingAverage };
+
+// Smooths the values with a window that extends 'radius' keyframes to each side. The
+// window is shortened at the ends of the curve. The work is split into segments that
+// are filtered in parallel
+std::vector<double> filterValues(const std::vector<double>& values, Filter filter,
+    int radius);
+
+// Smooths the quaternions formed by the four orientation channels (w, x, y, z). Before
+// averaging, every neighbor is flipped into the hemisphere of the center quaternion and
+// the result is normalized again
+std::array<std::vector<double>, 4> filterOrientation(
+    const std::array<const std::vector<double>*, 4>& orientation, Filter filter,
+    int radius);
@@ -0,0 +1,325 @@
+#include "editjournal.h"
+
+#include <charconv>
+#include <chrono>
+#include <iterator>
+#include <string_view>
+
+namespace {
+    constexpr const std::string_view JournalHeader = "SessionRecordingEditor/journal01";
+
+    // Entries are written once this many have been collected or when the interval has
+    // passed, whatever comes first
+    constexpr const size_t BatchSize = 64;
+    constexpr const std::chrono::milliseconds FlushInterval = std::chrono::milliseconds(500);
+
+    // The shortest representation that parses back into the same value
+    template <typename T>
+    void appendValue(std::string& buffer, T value) {
+        char text[32];
+        std::to_chars_result result = std::to_chars(text, text + sizeof(text), value);
+        buffer += ' ';
+        buffer.append(text, result.ptr);
+    }
+
+    template <typename T>
+    bool parseValue(std::string_view token, T& value) {
+        std::from_chars_result result =
+            std::from_chars(token.data(), token.data() + token.size(), value);
+        return result.ec == std::errc() && result.ptr == token.data() + token.size();
+    }
+
+    std::vector<std::string_view> splitTokens(std::string_view line) {
+        std::vector<std::string_view> res;
+        size_t begin = 0;
+        while (begin < line.size()) {
+            size_t end = line.find(' ', begin);
+            if (end == std::string_view::npos)  end = line.size();
+            if (end > begin)  res.push_back(line.substr(begin, end - begin));
+            begin = end + 1;
+        }
+        return res;
+    }
+
+    // The size and modification time identify the version of the recording that a
+    // journal was started on
+    bool recordingIdentity(const std::filesystem::path& recording, std::uintmax_t& size,
+                           long long& modified)
+    {
+        std::error_code ec;
+        size = std::filesystem::file_size(recording, ec);
+        if (ec)  return false;
+        std::filesystem::file_time_type time =
+            std::filesystem::last_write_time(recording, ec);
+        if (ec)  return false;
+        modified = static_cast<long long>(time.time_since_epoch().count());
+        return true;
+    }
+
+    bool parseChannel(std::string_view token, Channel& channel) {
+        size_t value = 0;
+        if (!parseValue(token, value) || value >= NumberOfChannels)  return false;
+        channel = static_cast<Channel>(value);
+        return true;
+    }
+
+    std::string formatEntry(const JournalEntry& entry) {
+        std::string res;
+        switch (entry.kind) {
+            case JournalEntry::Kind::Channel:
+                res = "channel";
+                appendValue(res, static_cast<size_t>(entry.channel));
+                break;
+            case JournalEntry::Kind::Move:
+                res = "move";
+                appendValue(res, entry.index);
+                appendValue(res, entry.y);
+                break;
+            case JournalEntry::Kind::Insert:
+                res = "insert";
+                appendValue(res, entry.index);
+                appendValue(res, entry.y);
+                break;
+            case JournalEntry::Kind::Rescale:
+                res = "rescale";
+                appendValue(res, entry.range.first);
+                appendValue(res, entry.range.second);
+                break;
+            case JournalEntry::Kind::Commit:
+                res = "commit";
+                break;
+            case JournalEntry::Kind::Filter:
+                res = "filter";
+                appendValue(res, static_cast<int>(entry.filter));
+                appendValue(res, entry.radius);
+                break;
+            case JournalEntry::Kind::Retime:
+                res = "retime";
+                appendValue(res, entry.range.first);
+                appendValue(res, entry.range.second);
+                appendValue(res, entry.speed);
+                break;
+            case JournalEntry::Kind::Cut:
+                res = "cut";
+                appendValue(res, entry.range.first);
+                appendValue(res, entry.range.second);
+                break;
+        }
+        res += '\n';
+        return res;
+    }
+
+    bool parseEntry(std::string_view line, JournalEntry& entry) {
+        std::vector<std::string_view> tokens = splitTokens(line);
+        if (tokens.empty())  return false;
+
+        std::string_view kind = tokens[0];
+        if (kind == "channel" && tokens.size() == 2) {
+            entry.kind = JournalEntry::Kind::Channel;
+            return parseChannel(tokens[1], entry.channel);
+        }
+        if ((kind == "move" || kind == "insert") && tokens.size() == 3) {
+            entry.kind = kind == "move" ?
+                JournalEntry::Kind::Move :
+                JournalEntry::Kind::Insert;
+            return parseValue(tokens[1], entry.index) && parseValue(tokens[2], entry.y);
+        }
+        if ((kind == "rescale" || kind == "cut") && tokens.size() == 3) {
+            entry.kind = kind == "rescale" ?
+                JournalEntry::Kind::Rescale :
+                JournalEntry::Kind::Cut;
+            return parseValue(tokens[1], entry.range.first) &&
+                parseValue(tokens[2], entry.range.second) &&
+                entry.range.first < entry.range.second;
+        }
+        if (kind == "commit" && tokens.size() == 1) {
+            entry.kind = JournalEntry::Kind::Commit;
+            return true;
+        }
+        if (kind == "filter" && tokens.size() == 3) {
+            entry.kind = JournalEntry::Kind::Filter;
+            int filter = 0;
+            if (!parseValue(tokens[1], filter) || !parseValue(tokens[2], entry.radius)) {
+                return false;
+            }
+            if (filter != static_cast<int>(Filter::Gaussian) &&
+                filter != static_cast<int>(Filter::MovingAverage))
+            {
+                return false;
+            }
+            entry.filter = static_cast<Filter>(filter);
+            return entry.radius > 0;
+        }
+        if (kind == "retime" && tokens.size() == 4) {
+            entry.kind = JournalEntry::Kind::Retime;
+            return parseValue(tokens[1], entry.range.first) &&
+                parseValue(tokens[2], entry.range.second) &&
+                parseValue(tokens[3], entry.speed) &&
+                entry.range.first < entry.range.second && entry.speed > 0.0;
+        }
+        return false;
+    }
+} // namespace
+
+std::filesystem::path journalPath(const std::filesystem::path& recording) {
+    std::filesystem::path res = recording;
+    res += ".journal";
+    return res;
+}
+
+bool loadJournal(const std::filesystem::path& recording, Channel& channel,
+                 std::vector<JournalEntry>& entries)
+{
+    std::ifstream file(journalPath(recording));
+    if (!file.good())  return false;
+
+    // The journal only applies to the exact recording it was started on
+    std::string line;
+    std::getline(file, line);
+    std::vector<std::string_view> header = splitTokens(line);
+    std::uintmax_t size = 0;
+    long long modified = 0;
+    if (header.size() != 4 || header[0] != JournalHeader ||
+        !parseValue(header[1], size) || !parseValue(header[2], modified) ||
+        !parseChannel(header[3], channel))
+    {
+        return false;
+    }
+
+    std::uintmax_t recordingSize = 0;
+    long long recordingModified = 0;
+    if (!recordingIdentity(recording, recordingSize, recordingModified) ||
+        size != recordingSize || modified != recordingModified)
+    {
+        return false;
+    }
+
+    while (std::getline(file, line)) {
+        // If the editor crashed in the middle of a batch, the last line might be cut off
+        if (file.eof())  break;
+
+        JournalEntry entry;
+        if (!parseEntry(line, entry))  break;
+        entries.push_back(entry);
+    }
+    return true;
+}
+
+void removeJournal(const std::filesystem::path& recording) {
+    std::error_code ec;
+    std::filesystem::remove(journalPath(recording), ec);
+}
+
+EditJournal::EditJournal(std::filesystem::path recording, Channel channel,
+                         bool keepEntries)
+    : _recording(std::move(recording))
+    , _channel(channel)
+    , _keepEntries(keepEntries)
+    , _writer(&EditJournal::run, this)
+{
+    // The identity is taken now, as the edits apply to the recording as it was loaded
+    recordingIdentity(_recording, _recordingSize, _recordingModified);
+}
+
+EditJournal::~EditJournal() {
+    stop();
+}
+
+bool EditJournal::append(const JournalEntry& entry) {
+    std::string line = formatEntry(entry);
+
+    std::lock_guard lock(_mutex);
+    if (_isClosed)  return true;
+    if (!_isOpen) {
+        if (!open()) {
+            _isClosed = true;
+            return false;
+        }
+        _isOpen = true;
+    }
+
+    _pending += line;
+    _nPending += 1;
+    if (_nPending >= BatchSize)  _condition.notify_one();
+    return true;
+}
+
+void EditJournal::discard() {
+    stop();
+    {
+        std::lock_guard lock(_mutex);
+        _file.close();
+        _isOpen = false;
+        _isClosed = true;
+    }
+
+    removeJournal(_recording);
+}
+
+bool EditJournal::open() {
+    std::filesystem::path path = journalPath(_recording);
+    if (_keepEntries) {
+        // A line that was cut off by a crash was not replayed, so it must not become
+        // part of the journal by being continued
+        std::ifstream previous(path, std::ios::binary);
+        std::string content(
+            (std::istreambuf_iterator<char>(previous)), std::istreambuf_iterator<char>()
+        );
+        previous.close();
+        size_t end = content.rfind('\n');
+        if (end != content.size() - 1) {
+            std::error_code ec;
+            std::filesystem::resize_file(
+                path, end == std::string::npos ? 0 : end + 1, ec
+            );
+        }
+
+        _file.open(path, std::ios::app);
+    }
+    else {
+        _file.open(path, std::ios::trunc);
+        _file << JournalHeader << ' ' << _recordingSize << ' ' << _recordingModified
+            << ' ' << static_cast<size_t>(_channel) << '\n';
+        _file.flush();
+    }
+
+    if (!_file.good()) {
+        _file.close();
+        return false;
+    }
+    return true;
+}
+
+void EditJournal::stop() {
+    {
+        std::lock_guard lock(_mutex);
+        _isStopping = true;
+    }
+    _condition.notify_one();
+    if (_writer.joinable())  _writer.join();
+}
+
+void EditJournal::run() {
+    std::unique_lock lock(_mutex);
+    while (true) {
+        _condition.wait_for(
+            lock, FlushInterval,
+            [this]() { return _isStopping || _nPending >= BatchSize; }
+        );
+
+        if (!_pending.empty()) {
+            // The file is only touched by this thread once entries are pending, so the
+            // batch can be written without blocking new entries
+            std::string batch;
+            batch.swap(_pending);
+            _nPending = 0;
+
+            lock.unlock();
+            _file << batch;
+            _file.flush();
+            lock.lock();
+        }
+
+        if (_isStopping)  break;
+    }
+}
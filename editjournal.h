@@ -0,0 +1,85 @@
+#pragma once
+
+#include "curve.h"
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// A single edit in the scale widget. Replaying the entries in order on the recording they
+// were recorded for restores the edited state
+struct JournalEntry {
+    enum class Kind { Channel, Move, Insert, Rescale, Commit, Filter, Retime, Cut };
+    Kind kind = Kind::Commit;
+
+    // Channel: the channel that is edited from now on
+    Channel channel = Channel::Scale;
+    // Move, Insert: the camera keyframe of the point and its normalized value
+    size_t index = 0;
+    double y = 0.0;
+    // Rescale: the new value range. Retime, Cut: the recording time range
+    std::pair<double, double> range = { 0.0, 0.0 };
+    // Retime
+    double speed = 1.0;
+    // Filter
+    Filter filter = Filter::Gaussian;
+    int radius = 0;
+};
+
+// The journal is stored beside the recording it belongs to
+std::filesystem::path journalPath(const std::filesystem::path& recording);
+
+// Reads the journal of the recording. Returns false if there is no journal or if it was
+// written for a different version of the recording. 'channel' is the channel that was shown
+// when the journal was started. A partially written last entry is ignored
+bool loadJournal(const std::filesystem::path& recording, Channel& channel,
+    std::vector<JournalEntry>& entries);
+
+// Removes the journal of the recording if there is one
+void removeJournal(const std::filesystem::path& recording);
+
+// Append-only journal of the edits of a recording, so that they survive a crash without
+// rewriting the recording. Entries are collected and written in small batches by a
+// background thread. The file is only created with the first entry
+class EditJournal {
+public:
+    // If 'keepEntries' is true, new entries are appended to an existing journal. Otherwise
+    // it is replaced and starts with 'channel' as the shown channel
+    EditJournal(std::filesystem::path recording, Channel channel, bool keepEntries);
+    ~EditJournal();
+
+    // Returns false if the journal file could not be created. This is only reported for
+    // the first entry, all later entries are dropped silently
+    bool append(const JournalEntry& entry);
+
+    // Removes the journal after the recording has been saved
+    void discard();
+
+private:
+    bool open();
+    void stop();
+    void run();
+
+    const std::filesystem::path _recording;
+    const Channel _channel;
+    const bool _keepEntries;
+    std::uintmax_t _recordingSize = 0;
+    long long _recordingModified = 0;
+
+    // The file is opened by the thread that appends the first entry and is only written
+    // by the writer thread afterwards. The flags are guarded by the mutex
+    std::mutex _mutex;
+    std::ofstream _file;
+    bool _isOpen = false;
+    bool _isClosed = false;
+
+    std::condition_variable _condition;
+    std::string _pending;
+    size_t _nPending = 0;
+    bool _isStopping = false;
+    std::thread _writer;
+};
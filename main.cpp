@@ -2,18 +2,136 @@
 #include <QWidget>
 
 #include "mainwindow.h"
+#include "profiling.h"
+#include "sessiondiff.h"
+#include "sessionrecording.h"
+#include "sessionvalidation.h"
 #include <iostream>
+#include <string_view>
+
+namespace {
+    void printUsage() {
+        std::cout <<
+            "Usage:\n"
+            "  editor [--trace <file>] [recording]\n"
+            "  editor --concat <output> <input> <input>...\n"
+            "  editor --merge <output> <input> <input>...\n"
+            "  editor --diff <first> <second> [report] [--time-tolerance <value>]\n"
+            "         [--position-tolerance <value>] [--orientation-tolerance <value>]\n"
+            "         [--scale-tolerance <value>]\n"
+            "  editor --validate <recording>\n"
+            "  editor --search <recording> <text>\n"
+            "\n"
+            "--trace enables profiling and writes a Chrome trace to <file> at the end\n";
+    }
+
+    int runHeadless(int argc, char** argv) {
+        setHeadless(true);
+
+        std::string_view command = argv[1];
+        if ((command == "--concat" || command == "--merge") && argc >= 5) {
+            std::filesystem::path output = argv[2];
+            std::vector<std::filesystem::path> inputs(argv + 3, argv + argc);
+
+            bool success = command == "--concat" ?
+                concatenateSessionRecordings(inputs, output) :
+                mergeSessionRecordings(inputs, output);
+            return success ? 0 : 1;
+        }
+
+        if (command == "--validate" && argc == 3) {
+            ValidationReport report = validateSessionRecording(argv[2], ValidationOptions());
+            std::cout << validationSummary(report);
+            return report.isValid() ? 0 : 1;
+        }
+
+        if (command == "--search" && argc == 4) {
+            SessionRecording* recording = loadSessionRecording(argv[2]);
+            if (!recording)  return 2;
+
+            const ScriptIndex& index = recording->scriptIndex;
+            std::vector<size_t> results = searchScriptIndex(index, argv[3]);
+            for (size_t i : results) {
+                std::cout << index.keyframes[i]->recordingTime << ' '
+                    << index.keyframes[i]->script << '\n';
+            }
+            return results.empty() ? 1 : 0;
+        }
+
+        if (command == "--diff") {
+            DiffTolerances tolerances;
+            std::vector<std::string> files;
+            for (int i = 2; i < argc; i += 1) {
+                std::string_view arg = argv[i];
+                double* tolerance = nullptr;
+                if (arg == "--time-tolerance")  tolerance = &tolerances.time;
+                else if (arg == "--position-tolerance")  tolerance = &tolerances.position;
+                else if (arg == "--orientation-tolerance")  tolerance = &tolerances.orientation;
+                else if (arg == "--scale-tolerance")  tolerance = &tolerances.scale;
+
+                if (tolerance && i + 1 < argc) {
+                    *tolerance = std::atof(argv[i + 1]);
+                    i += 1;
+                }
+                else {
+                    files.push_back(argv[i]);
+                }
+            }
+            if (files.size() != 2 && files.size() != 3) {
+                printUsage();
+                return 2;
+            }
+
+            SessionRecording* first = loadSessionRecording(files[0]);
+            SessionRecording* second = loadSessionRecording(files[1]);
+            if (!first || !second)  return 2;
+
+            SessionDiff diff = diffSessionRecordings(first, second, tolerances);
+            std::cout << diffSummary(diff);
+            if (files.size() == 3 && !saveDiffReport(diff, files[2])) {
+                std::cerr << "Could not save diff report to '" << files[2] << "'\n";
+                return 2;
+            }
+            return diff.isEqual() ? 0 : 1;
+        }
+
+        printUsage();
+        return 1;
+    }
+} // namespace
 
 int main(int argc, char** argv) {
-    QApplication app(argc, argv);
+    std::string tracePath;
+    if (argc >= 3 && std::string_view(argv[1]) == "--trace") {
+        tracePath = argv[2];
+        setProfilingEnabled(true);
 
-    MainWindow w;
-    w.show();
+        // Remove the option so that the rest of the arguments are handled as usual
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
 
-    if (argc == 2) {
-        std::string file = argv[1];
+    int result = 0;
+    if (argc >= 2 && std::string_view(argv[1]).substr(0, 2) == "--") {
+        result = runHeadless(argc, argv);
+    }
+    else {
+        QApplication app(argc, argv);
+
+        MainWindow w;
+        w.show();
 
+        if (argc == 2) {
+            std::string file = argv[1];
+            w.loadFile(file);
+        }
+
+        result = app.exec();
     }
 
-    app.exec();
+    if (!tracePath.empty() && !saveProfilingTrace(tracePath)) {
+        std::cerr << "Could not save profiling trace to '" << tracePath << "'\n";
+    }
+    return result;
 }
@@ -1,11 +1,17 @@
 #include "mainwindow.h"
 
+#include "profiling.h"
 #include "scalewidget.h"
+#include "sessiondiff.h"
+#include "sessionvalidation.h"
 #include <QDragEnterEvent>
 #include <QDropEvent>
+#include <QFileDialog>
 #include <QHBoxLayout>
 #include <QLineEdit>
+#include <QMessageBox>
 #include <QMimeData>
+#include <QPlainTextEdit>
 #include <QPushButton>
 #include <QVBoxLayout>
 #include <iostream>
@@ -21,6 +27,11 @@ MainWindow::MainWindow() {
     _scaleWidget = new ScaleWidget(this);
     layout->addWidget(_scaleWidget);
 
+    _report = new QPlainTextEdit;
+    _report->setReadOnly(true);
+    _report->setVisible(false);
+    layout->addWidget(_report);
+
     {
         QWidget* container = new QWidget;
         QBoxLayout* containerLayout = new QHBoxLayout;
@@ -38,6 +49,38 @@ MainWindow::MainWindow() {
         connect(save, &QPushButton::clicked, [this]() { saveRecording(); });
         containerLayout->addWidget(save);
 
+        QPushButton* concatenate = new QPushButton("Concatenate...");
+        connect(
+            concatenate, &QPushButton::clicked,
+            [this]() { combineRecordings(false); }
+        );
+        containerLayout->addWidget(concatenate);
+
+        QPushButton* merge = new QPushButton("Merge...");
+        connect(merge, &QPushButton::clicked, [this]() { combineRecordings(true); });
+        containerLayout->addWidget(merge);
+
+        QPushButton* diff = new QPushButton("Diff...");
+        connect(diff, &QPushButton::clicked, [this]() { diffRecording(); });
+        containerLayout->addWidget(diff);
+
+        _showReport = new QPushButton("Report");
+        _showReport->setCheckable(true);
+        connect(_showReport, &QPushButton::toggled, this, &MainWindow::showReport);
+        containerLayout->addWidget(_showReport);
+
+        QPushButton* profiling = new QPushButton("Profiling");
+        profiling->setCheckable(true);
+        connect(
+            profiling, &QPushButton::toggled,
+            _scaleWidget, &ScaleWidget::setProfilingOverlayVisible
+        );
+        containerLayout->addWidget(profiling);
+
+        QPushButton* exportTrace = new QPushButton("Export trace...");
+        connect(exportTrace, &QPushButton::clicked, [this]() { exportProfilingTrace(); });
+        containerLayout->addWidget(exportTrace);
+
         container->setLayout(containerLayout);
         layout->addWidget(container);
     }
@@ -47,10 +90,50 @@ MainWindow::MainWindow() {
 }
 
 void MainWindow::loadFile(std::string path) {
+    // A report of the previous recording does not apply anymore
+    _showReport->setChecked(false);
+
+    // Edits to the previous recording have to be written before it is replaced
+    _scaleWidget->setJournal(nullptr);
+    _journal = nullptr;
+
     _sessionRecording = loadSessionRecording(path);
     _sourceFile->setText(QString::fromStdString(path));
+    if (!_sessionRecording) {
+        // The report shows all problems of the file, not only the first one
+        _showReport->setChecked(true);
+        return;
+    }
+
+    _scaleWidget->setSessionRecording(_sessionRecording);
 
-    if (_sessionRecording)  _scaleWidget->setSessionRecording(_sessionRecording);
+    bool keepJournal = false;
+    if (std::filesystem::exists(journalPath(path))) {
+        Channel channel = Channel::Scale;
+        std::vector<JournalEntry> entries;
+        if (!loadJournal(path, channel, entries)) {
+            QMessageBox::warning(this, "Edit journal discarded",
+                "The edit journal of this recording does not match the recording and "
+                "is discarded"
+            );
+        }
+        else if (!entries.empty()) {
+            QMessageBox::StandardButton button = QMessageBox::question(
+                this, "Restore edits",
+                "There are " + QString::number(entries.size()) +
+                " unsaved edits from a previous session. Restore them?"
+            );
+            if (button == QMessageBox::Yes) {
+                _scaleWidget->replayJournal(channel, entries);
+                keepJournal = true;
+            }
+        }
+    }
+    // Otherwise a journal that is not replayed now could be offered again later
+    if (!keepJournal)  removeJournal(path);
+
+    _journal = std::make_unique<EditJournal>(path, _scaleWidget->_channel, keepJournal);
+    _scaleWidget->setJournal(_journal.get());
 }
 
 void MainWindow::dragEnterEvent(QDragEnterEvent* event) {
@@ -65,7 +148,116 @@ void MainWindow::dropEvent(QDropEvent* event) {
 }
 
 void MainWindow::saveRecording() {
-    if (_destinationFile->text().isEmpty())  return;
+    if (!_sessionRecording || _destinationFile->text().isEmpty())  return;
     _scaleWidget->updateSessionRecording();
-    saveSessionRecording(_sessionRecording, _destinationFile->text().toStdString());
+
+    std::string path = _destinationFile->text().toStdString();
+    if (!saveSessionRecording(_sessionRecording, path))  return;
+
+    // All edits are part of the saved recording now, so further edits are journaled
+    // against it instead
+    _scaleWidget->setJournal(nullptr);
+    _journal->discard();
+    // A journal of an earlier version of the destination no longer applies
+    removeJournal(path);
+    _journal = std::make_unique<EditJournal>(path, _scaleWidget->_channel, false);
+    _scaleWidget->setJournal(_journal.get());
+    _sourceFile->setText(QString::fromStdString(path));
+    _showReport->setChecked(false);
+}
+
+void MainWindow::showReport(bool visible) {
+    _report->setVisible(visible);
+    if (!visible) {
+        _report->clear();
+        return;
+    }
+
+    // Validating reads the whole file again, so it is only done when the report is shown
+    std::string path = _sourceFile->text().toStdString();
+    ValidationReport report = validateSessionRecording(path, ValidationOptions());
+    _report->setPlainText(QString::fromStdString(validationSummary(report)));
+}
+
+void MainWindow::combineRecordings(bool merge) {
+    const QString filter = "Session recordings (*.osrectxt);;All files (*)";
+    QStringList files;
+    if (merge) {
+        files = QFileDialog::getOpenFileNames(this, "Select recordings", "", filter);
+    }
+    else {
+        // The order in which multiple selected files are returned is up to the dialog, so
+        // the recordings are picked one at a time in playback order instead
+        while (true) {
+            QString file = QFileDialog::getOpenFileName(
+                this,
+                "Select recording " + QString::number(files.size() + 1) +
+                    " (cancel to finish)",
+                "", filter
+            );
+            if (file.isEmpty())  break;
+            files.push_back(file);
+        }
+    }
+    if (files.size() < 2)  return;
+
+    QString output = QFileDialog::getSaveFileName(this, "Save combined recording");
+    if (output.isEmpty())  return;
+
+    std::vector<std::filesystem::path> inputs;
+    for (const QString& file : files) {
+        inputs.push_back(file.toStdString());
+    }
+
+    bool success = merge ?
+        mergeSessionRecordings(inputs, output.toStdString()) :
+        concatenateSessionRecordings(inputs, output.toStdString());
+    if (success)  loadFile(output.toStdString());
+}
+
+void MainWindow::diffRecording() {
+    if (!_sessionRecording)  return;
+
+    QString file = QFileDialog::getOpenFileName(
+        this, "Select recording to compare against", "",
+        "Session recordings (*.osrectxt);;All files (*)"
+    );
+    if (file.isEmpty())  return;
+
+    SessionRecording* other = loadSessionRecording(file.toStdString());
+    if (!other)  return;
+
+    // Compare against the curve as it is currently shown
+    _scaleWidget->updateSessionRecording();
+    SessionDiff diff = diffSessionRecordings(_sessionRecording, other, DiffTolerances());
+    // The overlay keeps its own copy of the curve, so the recording is no longer needed
+    _scaleWidget->setDiffOverlay(other, diff);
+    deleteSessionRecording(other);
+
+    QMessageBox::StandardButton button = QMessageBox::question(
+        this, "Recording differences",
+        QString::fromStdString(diffSummary(diff) + "\nSave per-keyframe report?")
+    );
+    if (button != QMessageBox::Yes)  return;
+
+    QString report = QFileDialog::getSaveFileName(this, "Save diff report");
+    if (report.isEmpty())  return;
+    if (!saveDiffReport(diff, report.toStdString())) {
+        QMessageBox::critical(this, "Error saving diff report",
+            "Could not save diff report. Path incorrect?"
+        );
+    }
+}
+
+void MainWindow::exportProfilingTrace() {
+    QString file = QFileDialog::getSaveFileName(
+        this, "Export profiling trace", "", "Chrome trace (*.json)"
+    );
+    if (file.isEmpty())  return;
+
+    if (!saveProfilingTrace(file.toStdString())) {
+        QMessageBox::critical(this, "Error exporting profiling trace",
+            "Could not export profiling trace. Path incorrect?"
+        );
+    }
 }
@@ -2,25 +2,48 @@
 
 #include <QMainWindow>
 
+#include "editjournal.h"
 #include "sessionrecording.h"
 #include "scalewidget.h"
+#include <memory>
 
 class QLineEdit;
+class QPlainTextEdit;
+class QPushButton;
 
 class MainWindow : public QMainWindow {
 Q_OBJECT
 public:
     MainWindow();
 
+    // Loads the recording and offers to restore the edits from its journal
     void loadFile(std::string path);
     
     virtual void dragEnterEvent(QDragEnterEvent* event) override;
     virtual void dropEvent(QDropEvent* event) override;
     void saveRecording();
 
+    // Validates the source recording and shows the result
+    void showReport(bool visible);
+
+    // Asks for a list of recordings and an output file and then either concatenates the
+    // recordings or merges them by their recording time
+    void combineRecordings(bool merge);
+
+    // Asks for a second recording and compares the current recording against it
+    void diffRecording();
+
+    void exportProfilingTrace();
+
     ScaleWidget* _scaleWidget = nullptr;
     SessionRecording* _sessionRecording = nullptr;
 
+    // Records the edits of the current recording until it is saved
+    std::unique_ptr<EditJournal> _journal;
+
     QLineEdit* _sourceFile;
     QLineEdit* _destinationFile;
+
+    QPlainTextEdit* _report;
+    QPushButton* _showReport;
 };
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Returns into how many chunks a range of n elements should be split so that every
+// hardware thread gets a chunk, but no chunk is smaller than minChunkSize
+inline size_t parallelChunkCount(size_t n, size_t minChunkSize = 4096) {
+    size_t nThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    return std::clamp<size_t>(n / minChunkSize, 1, nThreads);
+}
+
+// Splits [0, n) into nChunks contiguous ranges and concurrently calls
+// f(chunk, begin, end) for each of them. The first chunk runs on the calling thread
+template <typename F>
+void parallelForChunks(size_t n, size_t nChunks, F&& f) {
+    assert(nChunks > 0);
+
+    std::vector<std::thread> threads;
+    threads.reserve(nChunks - 1);
+    for (size_t chunk = 1; chunk < nChunks; chunk += 1) {
+        threads.emplace_back(
+            std::ref(f), chunk, chunk * n / nChunks, (chunk + 1) * n / nChunks
+        );
+    }
+    f(size_t(0), size_t(0), n / nChunks);
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
@@ -0,0 +1,137 @@
+#include "profiling.h"
+
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace {
+    constexpr const size_t NumberOfCounters = 6;
+    constexpr const std::array<const char*, NumberOfCounters> CounterNames = {
+        "Bytes read", "Bytes written", "Lines parsed", "Keyframes allocated",
+        "Curve points simplified", "Scene items created"
+    };
+
+    struct Event {
+        const char* name;
+        long long begin;
+        long long duration;
+        unsigned int thread;
+    };
+
+    struct ScopeStatistics {
+        size_t count = 0;
+        double totalMs = 0.0;
+        double lastMs = 0.0;
+    };
+
+    std::atomic<bool> IsEnabled = false;
+    std::array<std::atomic<size_t>, NumberOfCounters> Counters = {};
+
+    // Only touched while profiling is enabled
+    std::mutex Mutex;
+    std::vector<Event> Events;
+    std::map<std::string, ScopeStatistics> Statistics;
+    const std::chrono::steady_clock::time_point Epoch = std::chrono::steady_clock::now();
+
+    unsigned int threadIndex() {
+        static std::atomic<unsigned int> NextIndex = 0;
+        thread_local unsigned int Index = NextIndex++;
+        return Index;
+    }
+
+    long long microseconds(std::chrono::steady_clock::duration duration) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    }
+} // namespace
+
+void setProfilingEnabled(bool enabled) {
+    IsEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool isProfilingEnabled() {
+    return IsEnabled.load(std::memory_order_relaxed);
+}
+
+void addToCounter(Counter counter, size_t value) {
+    if (!isProfilingEnabled())  return;
+    Counters[static_cast<size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+}
+
+void resetProfiling() {
+    std::lock_guard lock(Mutex);
+    Events.clear();
+    Statistics.clear();
+    for (std::atomic<size_t>& c : Counters) {
+        c.store(0, std::memory_order_relaxed);
+    }
+}
+
+std::string profilingSummary() {
+    std::lock_guard lock(Mutex);
+
+    std::ostringstream s;
+    s.precision(3);
+    s << std::fixed;
+    for (const std::pair<const std::string, ScopeStatistics>& p : Statistics) {
+        s << p.first << ": " << p.second.lastMs << " ms (" << p.second.count
+            << "x, total " << p.second.totalMs << " ms)\n";
+    }
+    for (size_t i = 0; i < NumberOfCounters; i += 1) {
+        s << CounterNames[i] << ": " << Counters[i].load(std::memory_order_relaxed);
+        s << (i == NumberOfCounters - 1 ? "" : "\n");
+    }
+    return s.str();
+}
+
+bool saveProfilingTrace(std::filesystem::path path) {
+    std::ofstream f(path);
+    if (!f.good())  return false;
+
+    std::lock_guard lock(Mutex);
+    f << "{\"traceEvents\":[\n";
+    long long end = 0;
+    for (const Event& e : Events) {
+        f << "{\"name\":\"" << e.name << "\",\"cat\":\"editor\",\"ph\":\"X\",\"ts\":"
+            << e.begin << ",\"dur\":" << e.duration << ",\"pid\":1,\"tid\":" << e.thread
+            << "},\n";
+        end = std::max(end, e.begin + e.duration);
+    }
+
+    // Counters are reported once with their final values
+    f << "{\"name\":\"Counters\",\"ph\":\"C\",\"ts\":" << end << ",\"pid\":1,\"args\":{";
+    for (size_t i = 0; i < NumberOfCounters; i += 1) {
+        f << '"' << CounterNames[i] << "\":" << Counters[i].load(std::memory_order_relaxed);
+        f << (i == NumberOfCounters - 1 ? "" : ",");
+    }
+    f << "}}\n]}\n";
+    return f.good();
+}
+
+ScopedTimer::ScopedTimer(const char* name) {
+    if (!isProfilingEnabled())  return;
+
+    _name = name;
+    _begin = std::chrono::steady_clock::now();
+}
+
+ScopedTimer::~ScopedTimer() {
+    if (!_name)  return;
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    Event e;
+    e.name = _name;
+    e.begin = microseconds(_begin - Epoch);
+    e.duration = microseconds(end - _begin);
+    e.thread = threadIndex();
+
+    std::lock_guard lock(Mutex);
+    Events.push_back(e);
+    ScopeStatistics& stats = Statistics[_name];
+    stats.count += 1;
+    stats.lastMs = std::chrono::duration<double, std::milli>(end - _begin).count();
+    stats.totalMs += stats.lastMs;
+}
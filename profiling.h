@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+
+enum class Counter {
+    BytesRead = 0,
+    BytesWritten,
+    LinesParsed,
+    KeyframesAllocated,
+    CurvePointsSimplified,
+    SceneItemsCreated
+};
+
+// Profiling is disabled by default. While it is disabled, timers and counters only check
+// this flag and do nothing else
+void setProfilingEnabled(bool enabled);
+bool isProfilingEnabled();
+
+void addToCounter(Counter counter, size_t value);
+
+// Discards all recorded events and resets the counters
+void resetProfiling();
+
+// Human readable summary of the timers and counters for the status overlay
+std::string profilingSummary();
+
+// Writes all recorded events and counters in the Chrome trace event format
+bool saveProfilingTrace(std::filesystem::path path);
+
+// Records the time between its construction and destruction as an event with the
+// provided name. The name has to outlive the profiling session, so use string literals
+class ScopedTimer {
+public:
+    ScopedTimer(const char* name);
+    ~ScopedTimer();
+
+private:
+    const char* _name = nullptr;
+    std::chrono::steady_clock::time_point _begin;
+};
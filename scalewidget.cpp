@@ -1,24 +1,64 @@
 #include "scalewidget.h"
 
+#include "editjournal.h"
 #include "mainwindow.h"
+#include "profiling.h"
+#include "sessiondiff.h"
 #include "sessionrecording.h"
+#include <QComboBox>
 #include <QDoubleValidator>
+#include <QGraphicsPathItem>
 #include <QGraphicsScene>
 #include <QGraphicsView>
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QLineEdit>
+#include <QMessageBox>
+#include <QMetaObject>
+#include <QPushButton>
 #include <QResizeEvent>
 #include <QSlider>
+#include <QTimer>
 #include <QVBoxLayout>
+#include <algorithm>
 
 namespace {
     constexpr const int MaximumValue = 1000;
+    constexpr const int MaximumFilterRadius = 100;
+
+    // Points per bucket are reduced to their minimum and maximum, so that long curves
+    // don't create paths with millions of elements
+    constexpr const size_t NumberOfPathBuckets = 4096;
+
+    QPainterPath curvePath(const std::vector<double>& times,
+                           const std::vector<double>& values, const ChannelCurve& curve)
+    {
+        QPainterPath path;
+        if (values.empty())  return path;
+
+        const size_t bucketSize = std::max<size_t>(values.size() / NumberOfPathBuckets, 1);
+        path.moveTo(times[0], curve.normalize(values[0]));
+        for (size_t begin = 0; begin < values.size(); begin += bucketSize) {
+            const size_t end = std::min(begin + bucketSize, values.size());
+            std::vector<double>::const_iterator first = values.begin() + begin;
+            std::vector<double>::const_iterator last = values.begin() + end;
+            std::pair<
+                std::vector<double>::const_iterator, std::vector<double>::const_iterator
+            > mm = std::minmax_element(first, last);
+
+            // Keep the order in which minimum and maximum appear
+            size_t a = static_cast<size_t>(std::min(mm.first, mm.second) - values.begin());
+            size_t b = static_cast<size_t>(std::max(mm.first, mm.second) - values.begin());
+            path.lineTo(times[a], curve.normalize(values[a]));
+            if (b != a)  path.lineTo(times[b], curve.normalize(values[b]));
+        }
+        return path;
+    }
 } // namespace
 
-ScaleItem::ScaleItem(KeyframeCamera* kf, SessionRecording* recording, QColor color, 
+ScaleItem::ScaleItem(size_t index, SessionRecording* recording, QColor color,
                      double size)
-    : _keyframe(kf)
+    : _index(index)
     , _recording(recording)
     , _color(color)
     , _size(size)
@@ -74,35 +114,22 @@ void ScaleView::mouseMoveEvent(QMouseEvent* event) {
     QPointF pt = event->pos();
     QPointF scenePt = mapToScene(pt.x(), pt.y());
 
+    if (_isSelectingRange) {
+        double x = std::clamp(scenePt.x(), 0.0, 1.0);
+        _parent->setSelectedRange(std::min(_rangeAnchor, x), std::max(_rangeAnchor, x));
+        return;
+    }
+
     if (_pickedItem) {
         // We don't want the x coordinate to change
-        scenePt.rx() = _pickedItem->scenePos().x();
-
-        // Update item position
-        _pickedItem->setPos(scenePt);
-
-        // Update connected lines
-        if (_pickedItem->_leftLine) {
-            QGraphicsLineItem* left = _pickedItem->_leftLine;
-            QLineF leftLineOld = left->line();
-            QLineF leftLineNew = QLineF(leftLineOld.p1(), scenePt);
-            _pickedItem->_leftLine->setLine(leftLineNew);
-        }
-
-        if (_pickedItem->_rightLine) {
-            QGraphicsLineItem* right = _pickedItem->_rightLine;
-            QLineF rightLineOld = right->line();
-            QLineF rightLineNew = QLineF(scenePt, rightLineOld.p2());
-            _pickedItem->_rightLine->setLine(rightLineNew);
-        }
+        _parent->moveItem(_pickedItem, scenePt.y());
     }
     else {
         if (_recording) {
             double length = _recording->recordingLength;
-            std::pair<double, double> minMax = _recording->minMaxScale;
 
             double x = scenePt.x() * length;
-            double y = minMax.first + scenePt.y() * (minMax.second - minMax.first);
+            double y = _recording->curve(_parent->_channel).denormalize(scenePt.y());
 
             _parent->_hoverInfo->setText(QString::number(x) + ", " + QString::number(y));
         }
@@ -110,61 +137,26 @@ void ScaleView::mouseMoveEvent(QMouseEvent* event) {
 }
 
 void ScaleView::mouseDoubleClickEvent(QMouseEvent* event) {
-    QPointF pt = mapToScene(event->pos());
-
-    ScaleItem* prev = nullptr;
-    ScaleItem* next = nullptr;
-    for (ScaleItem* c : _parent->_items) {
-        if (c->scenePos().x() > pt.x()) {
-            next = c;
-            prev = next->_leftNeighbor;
-            break;
-        }
-    }
-
-    assert(prev && next);
-
-    ScaleInfo s;
-    for (ScaleInfo si : _parent->_recording->originalNormalizedScale) {
-        if (si.x >= pt.x()) {
-            s = si;
-            break;
-        }
-    }
-    
-    QPen pen;
-    pen.setColor(Qt::black);
-    pen.setWidthF(0.0025f);
-    QGraphicsLineItem* line = scene()->addLine(QLineF(pt, next->scenePos()), pen);
-    line->setZValue(0);
-
-    ScaleItem* item = new ScaleItem(s.kf, _recording, Qt::white, 5.0);
-    item->setPos(s.x, pt.y());
-    item->setZValue(1);
-    scene()->addItem(item);
-    _parent->_items.push_back(item);
-    std::sort(
-        _parent->_items.begin(), _parent->_items.end(),
-        [](ScaleItem* lhs, ScaleItem* rhs) { return lhs->scenePos().x() < rhs->scenePos().x(); }
-    );
-
-
-    QLineF newLineLeft = QLineF(prev->scenePos(), pt);
-    prev->_rightLine->setLine(newLineLeft);
-    item->_leftLine = prev->_rightLine;
-
-    item->_rightLine = line;
-    next->_leftLine = line;
+    if (!_recording)  return;
 
-    item->_leftNeighbor = prev;
-    prev->_rightNeighbor = item;
-    item->_rightNeighbor = next;
-    next->_leftNeighbor = item;
+    QPointF pt = mapToScene(event->pos());
+    const std::vector<double>& times = _recording->curveTimes;
+    size_t index = std::lower_bound(times.begin(), times.end(), pt.x()) - times.begin();
+    _parent->insertItem(index, pt.y());
 }
 
 void ScaleView::mousePressEvent(QMouseEvent* event) {
     QPointF pt = mapToScene(event->pos());
 
+    if (event->button() == Qt::MouseButton::LeftButton &&
+        event->modifiers() & Qt::KeyboardModifier::ShiftModifier)
+    {
+        _isSelectingRange = true;
+        _rangeAnchor = std::clamp(pt.x(), 0.0, 1.0);
+        _parent->setSelectedRange(_rangeAnchor, _rangeAnchor);
+        return;
+    }
+
     // Mark the previous one (if it exists) as unpicked
     if (_pickedItem) _pickedItem->_picked = false;
 
@@ -177,6 +169,7 @@ void ScaleView::mousePressEvent(QMouseEvent* event) {
                 // Select it
                 _pickedItem = i;
                 _pickedItem->_picked = true;
+                _pickedItemY = i->scenePos().y();
             }
             else if (event->button() == Qt::MouseButton::RightButton) {
 #if 0
@@ -210,7 +203,22 @@ void ScaleView::mousePressEvent(QMouseEvent* event) {
 }
 
 void ScaleView::mouseReleaseEvent(QMouseEvent* event) {
-    if (_pickedItem)  _pickedItem->_picked = false;
+    if (_isSelectingRange) {
+        _isSelectingRange = false;
+        const std::pair<double, double>& range = _parent->_selectedRange;
+        if (range.first >= range.second)  _parent->clearSelectedRange();
+    }
+
+    if (_pickedItem) {
+        _pickedItem->_picked = false;
+        if (_pickedItem->scenePos().y() != _pickedItemY) {
+            JournalEntry entry;
+            entry.kind = JournalEntry::Kind::Move;
+            entry.index = _pickedItem->_index;
+            entry.y = _pickedItem->scenePos().y();
+            _parent->appendToJournal(entry);
+        }
+    }
     _pickedItem = nullptr;
     scene()->update(sceneRect());
 }
@@ -235,6 +243,17 @@ ScaleWidget::ScaleWidget(MainWindow* mainWindow, QWidget* parent)
     _view->invalidateScene();
     layout->addWidget(_view);
 
+    _profilingOverlay = new QLabel(_view);
+    _profilingOverlay->setStyleSheet(
+        "background-color: rgba(0, 0, 0, 160); color: white; padding: 4px;"
+    );
+    _profilingOverlay->setAttribute(Qt::WA_TransparentForMouseEvents);
+    _profilingOverlay->move(8, 8);
+    _profilingOverlay->hide();
+
+    _profilingTimer = new QTimer(this);
+    connect(_profilingTimer, &QTimer::timeout, this, &ScaleWidget::updateProfilingOverlay);
+
     {
         QWidget* container = new QWidget;
         QBoxLayout* containerLayout = new QHBoxLayout;
@@ -266,28 +285,166 @@ ScaleWidget::ScaleWidget(MainWindow* mainWindow, QWidget* parent)
         layout->addWidget(container);
     }
 
+    {
+        QWidget* container = new QWidget;
+        QBoxLayout* containerLayout = new QHBoxLayout;
+
+        _selectedRangeText = new QLabel("Shift + drag to select a time range");
+        containerLayout->addWidget(_selectedRangeText);
+
+        _speedFactor = new QLineEdit("2.0");
+        _speedFactor->setValidator(new QDoubleValidator(0.001, 1000.0, 3, _speedFactor));
+        _speedFactor->setFixedWidth(60);
+        containerLayout->addWidget(_speedFactor);
+
+        QPushButton* applySpeed = new QPushButton("Apply speed");
+        connect(
+            applySpeed, &QPushButton::clicked,
+            this, &ScaleWidget::applySpeedToSelectedRange
+        );
+        containerLayout->addWidget(applySpeed);
+
+        QPushButton* cut = new QPushButton("Cut range");
+        connect(cut, &QPushButton::clicked, this, &ScaleWidget::cutSelectedRange);
+        containerLayout->addWidget(cut);
+
+        container->setLayout(containerLayout);
+        layout->addWidget(container);
+    }
+
+    {
+        QWidget* container = new QWidget;
+        QBoxLayout* containerLayout = new QHBoxLayout;
+
+        _channelSelection = new QComboBox;
+        for (size_t i = 0; i < NumberOfChannels; i += 1) {
+            _channelSelection->addItem(channelName(static_cast<Channel>(i)));
+        }
+        _channelSelection->setCurrentIndex(static_cast<int>(_channel));
+        connect(
+            _channelSelection, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &ScaleWidget::selectChannel
+        );
+        containerLayout->addWidget(_channelSelection);
+
+        _filterSelection = new QComboBox;
+        _filterSelection->addItem("Gaussian");
+        _filterSelection->addItem("Moving average");
+        connect(
+            _filterSelection, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &ScaleWidget::requestFilterPreview
+        );
+        containerLayout->addWidget(_filterSelection);
+
+        _filterRadius = new QSlider(Qt::Orientation::Horizontal);
+        _filterRadius->setRange(0, MaximumFilterRadius);
+        _filterRadius->setValue(0);
+        connect(
+            _filterRadius, &QSlider::valueChanged,
+            this, &ScaleWidget::requestFilterPreview
+        );
+        containerLayout->addWidget(_filterRadius);
+
+        _filterRadiusText = new QLabel("Radius: 0");
+        containerLayout->addWidget(_filterRadiusText);
+
+        QPushButton* apply = new QPushButton("Apply filter");
+        connect(apply, &QPushButton::clicked, this, &ScaleWidget::applyFilter);
+        containerLayout->addWidget(apply);
+
+        container->setLayout(containerLayout);
+        layout->addWidget(container);
+    }
+
+    {
+        QWidget* container = new QWidget;
+        QBoxLayout* containerLayout = new QHBoxLayout;
+
+        _searchText = new QLineEdit;
+        _searchText->setPlaceholderText("Search scripts");
+        _searchText->setClearButtonEnabled(true);
+        connect(_searchText, &QLineEdit::textChanged, this, &ScaleWidget::searchScripts);
+        connect(
+            _searchText, &QLineEdit::returnPressed,
+            [this]() { showSearchResult(_currentSearchResult + 1); }
+        );
+        containerLayout->addWidget(_searchText);
+
+        QPushButton* previous = new QPushButton("Previous");
+        connect(
+            previous, &QPushButton::clicked,
+            [this]() { showSearchResult(_currentSearchResult + _searchResults.size() - 1); }
+        );
+        containerLayout->addWidget(previous);
+
+        QPushButton* next = new QPushButton("Next");
+        connect(
+            next, &QPushButton::clicked,
+            [this]() { showSearchResult(_currentSearchResult + 1); }
+        );
+        containerLayout->addWidget(next);
+
+        _searchResultText = new QLabel;
+        containerLayout->addWidget(_searchResultText);
+
+        container->setLayout(containerLayout);
+        layout->addWidget(container);
+    }
+
     setLayout(layout);
 }
 
+ScaleWidget::~ScaleWidget() {
+    // The worker only posts its result back to us, so it has to be done before we are
+    if (_filterWorker.joinable())  _filterWorker.join();
+}
+
 void ScaleWidget::setSessionRecording(SessionRecording* recording) {
+    ScopedTimer timer("ScaleWidget::setSessionRecording");
     _recording = recording;
     _view->_recording = recording;
 
+    clearSelectedRange();
+    clearDiffOverlay();
     _items.clear();
     _scene->clear();
+    _filterPreview = nullptr;
+    _searchMarkers = nullptr;
+    _searchCurrent = nullptr;
+
+    rebuildItems();
+
+    // The script times might have changed, so the search has to be repeated
+    searchScripts();
+}
+
+void ScaleWidget::rebuildItems() {
+    // Each line is the right line of exactly one item
+    for (ScaleItem* item : _items) {
+        delete item->_rightLine;
+        delete item;
+    }
+    _items.clear();
+    _hasEdits = false;
+    _filterInput = nullptr;
+    delete _filterPreview;
+    _filterPreview = nullptr;
+
+    if (!_recording)  return;
 
-    _minValueText->setText(QString::number(recording->minMaxScale.first, 'f', 12));
-    _maxValueText->setText(QString::number(recording->minMaxScale.second, 'f', 12));
+    const ChannelCurve& curve = _recording->curve(_channel);
+    _minValueText->setText(QString::number(curve.minMax.first, 'f', 12));
+    _maxValueText->setText(QString::number(curve.minMax.second, 'f', 12));
 
-    for (ScaleInfo p : recording->normalizedLinearizedScale) {
-        ScaleItem* item = new ScaleItem(p.kf, _recording, Qt::white, 5.0);
-        item->setPos(p.x, p.y);
+    for (size_t index : curve.linearized) {
+        ScaleItem* item = new ScaleItem(index, _recording, Qt::white, 5.0);
+        item->setPos(_recording->curveTimes[index], curve.normalize(curve.values[index]));
         item->setZValue(1);
         _scene->addItem(item);
         _items.push_back(item);
     }
     
-    for (size_t i = 0; i < _items.size() - 1; i += 1) {
+    for (size_t i = 0; i + 1 < _items.size(); i += 1) {
         ScaleItem* curr = _items[i];
         ScaleItem* next = _items[i+1];
 
@@ -303,40 +460,179 @@ void ScaleWidget::setSessionRecording(SessionRecording* recording) {
         curr->_rightLine = line;
         next->_leftLine = line;
     }
+    addToCounter(Counter::SceneItemsCreated, 2 * _items.size() - 1);
 
     _view->fitInView(_scene->sceneRect());
     _view->invalidateScene();
+
+    // The preview has to follow the new curve
+    if (_filterRadius->value() > 0)  requestFilterPreview();
 }
 
 void ScaleWidget::updateSessionRecording() {
-    std::pair<double, double> minMax = _recording->minMaxScale;
+    if (!_recording || !_hasEdits || _items.empty())  return;
 
+    JournalEntry entry;
+    entry.kind = JournalEntry::Kind::Commit;
+    appendToJournal(entry);
+
+    const ChannelCurve& curve = _recording->curve(_channel);
+    const std::vector<double>& times = _recording->curveTimes;
+
+    // The change of each point relative to the value that is stored in the recording
+    std::vector<std::pair<size_t, double>> deltas;
+    deltas.reserve(_items.size());
     for (ScaleItem* i : _items) {
-        assert(i->_keyframe);
-        QPointF p = i->scenePos();
-        double y = minMax.first + p.y() * (minMax.second - minMax.first);
-        i->_keyframe->scale = y;
+        double value = curve.denormalize(i->scenePos().y());
+        deltas.emplace_back(i->_index, value - curve.values[i->_index]);
+    }
 
+    std::vector<double> values = curve.values;
+    for (size_t k = 0; k + 1 < deltas.size(); k += 1) {
+        const std::pair<size_t, double>& begin = deltas[k];
+        const std::pair<size_t, double>& end = deltas[k + 1];
+        const double x0 = times[begin.first];
+        const double x1 = times[end.first];
+        for (size_t j = begin.first; j < end.first; j += 1) {
+            double t = x1 > x0 ? (times[j] - x0) / (x1 - x0) : 0.0;
+            values[j] += begin.second + t * (end.second - begin.second);
+        }
     }
-    _view->fitInView(_scene->sceneRect());
-    _view->invalidateScene();
+    values[deltas.back().first] += deltas.back().second;
+
+    std::vector<KeyframeCamera*>& keyframes = _recording->curveKeyframes;
+    for (size_t i = 0; i < keyframes.size(); i += 1) {
+        setChannelValue(keyframes[i], _channel, values[i]);
+    }
+
+    if (isOrientationChannel(_channel)) {
+        // Changing one component of the orientation requires a renormalization, which
+        // changes the other components as well
+        for (KeyframeCamera* kf : keyframes) {
+            double length = std::sqrt(
+                kf->orientationW * kf->orientationW + kf->orientationX * kf->orientationX +
+                kf->orientationY * kf->orientationY + kf->orientationZ * kf->orientationZ
+            );
+            if (length == 0.0)  continue;
+            kf->orientationW /= length;
+            kf->orientationX /= length;
+            kf->orientationY /= length;
+            kf->orientationZ /= length;
+        }
+        updateChannelCurve(_recording, Channel::OrientationW);
+        updateChannelCurve(_recording, Channel::OrientationX);
+        updateChannelCurve(_recording, Channel::OrientationY);
+        updateChannelCurve(_recording, Channel::OrientationZ);
+    }
+    else {
+        updateChannelCurve(_recording, _channel);
+    }
+
+    rebuildItems();
+}
+
+void ScaleWidget::selectChannel(int index) {
+    updateSessionRecording();
+    _channel = static_cast<Channel>(index);
+    clearDiffOverlay();
+    rebuildItems();
+
+    JournalEntry entry;
+    entry.kind = JournalEntry::Kind::Channel;
+    entry.channel = _channel;
+    appendToJournal(entry);
+}
+
+void ScaleWidget::moveItem(ScaleItem* item, double y) {
+    QPointF pt = QPointF(item->scenePos().x(), y);
+    item->setPos(pt);
+    _hasEdits = true;
+
+    // Update connected lines
+    if (item->_leftLine) {
+        QLineF line = item->_leftLine->line();
+        item->_leftLine->setLine(QLineF(line.p1(), pt));
+    }
+
+    if (item->_rightLine) {
+        QLineF line = item->_rightLine->line();
+        item->_rightLine->setLine(QLineF(pt, line.p2()));
+    }
+}
+
+void ScaleWidget::insertItem(size_t index, double y) {
+    if (!_recording)  return;
+
+    std::vector<ScaleItem*>::iterator it = std::upper_bound(
+        _items.begin(), _items.end(), index,
+        [](size_t i, ScaleItem* item) { return i < item->_index; }
+    );
+    if (it == _items.begin() || it == _items.end())  return;
+
+    ScaleItem* prev = *(it - 1);
+    ScaleItem* next = *it;
+    // There already is a point for this keyframe
+    if (prev->_index == index)  return;
+
+    QPointF pt = QPointF(_recording->curveTimes[index], y);
+
+    QPen pen;
+    pen.setColor(Qt::black);
+    pen.setWidthF(0.0025f);
+    QGraphicsLineItem* line = _scene->addLine(QLineF(pt, next->scenePos()), pen);
+    line->setZValue(0);
+
+    ScaleItem* item = new ScaleItem(index, _recording, Qt::white, 5.0);
+    item->setPos(pt);
+    item->setZValue(1);
+    _scene->addItem(item);
+    _items.insert(it, item);
+
+    QLineF newLineLeft = QLineF(prev->scenePos(), pt);
+    prev->_rightLine->setLine(newLineLeft);
+    item->_leftLine = prev->_rightLine;
+
+    item->_rightLine = line;
+    next->_leftLine = line;
+
+    item->_leftNeighbor = prev;
+    prev->_rightNeighbor = item;
+    item->_rightNeighbor = next;
+    next->_leftNeighbor = item;
+    _hasEdits = true;
+
+    JournalEntry entry;
+    entry.kind = JournalEntry::Kind::Insert;
+    entry.index = index;
+    entry.y = y;
+    appendToJournal(entry);
 }
 
 void ScaleWidget::rescaleItems() {
     if (!_recording)  return;
+    ScopedTimer timer("ScaleWidget::rescaleItems");
 
-    double delta = (_recording->minMaxScale.second - _recording->minMaxScale.first) / MaximumValue;
+    const std::pair<double, double> oldMinMax = _recording->curve(_channel).minMax;
+    double delta = (oldMinMax.second - oldMinMax.first) / MaximumValue;
 
     std::pair<double, double> newMinMax;
-    newMinMax.first = _recording->minMaxScale.first + _minValue->value() * delta;
-    newMinMax.second = _recording->minMaxScale.second + _maxValue->value() * delta;
+    newMinMax.first = oldMinMax.first + _minValue->value() * delta;
+    newMinMax.second = oldMinMax.second + _maxValue->value() * delta;
 
     _minValueText->setText(QString::number(newMinMax.first, 'f', 15));
     _maxValueText->setText(QString::number(newMinMax.second, 'f', 15));
 
     if (newMinMax.first >= newMinMax.second)  return;
+    if (newMinMax != oldMinMax)  rescaleItemsTo(newMinMax);
+
+    _minValue->setValue(0);
+    _maxValue->setValue(0);
+}
+
+void ScaleWidget::rescaleItemsTo(std::pair<double, double> newMinMax) {
+    const std::pair<double, double> oldMinMax = _recording->curve(_channel).minMax;
+    _hasEdits = true;
 
-    std::pair<double, double> oldMinMax = _recording->minMaxScale;
     for (ScaleItem* item : _items) {
         QPointF p = item->pos();
         double y = oldMinMax.first + p.y() * (oldMinMax.second - oldMinMax.first);
@@ -356,8 +652,435 @@ void ScaleWidget::rescaleItems() {
         }
     }
 
-    _minValue->setValue(0);
-    _maxValue->setValue(0);
+    JournalEntry entry;
+    entry.kind = JournalEntry::Kind::Rescale;
+    entry.range = newMinMax;
+    appendToJournal(entry);
+}
+
+void ScaleWidget::setSelectedRange(double begin, double end) {
+    _selectedRange = std::pair(begin, end);
+
+    if (!_selectedRangeItem) {
+        _selectedRangeItem = _scene->addRect(
+            QRectF(), QPen(Qt::NoPen), QBrush(QColor(255, 255, 255, 48))
+        );
+        _selectedRangeItem->setZValue(-1);
+    }
+    _selectedRangeItem->setRect(QRectF(begin, 0.0, end - begin, 1.0));
+
+    if (_recording) {
+        double length = _recording->recordingLength;
+        _selectedRangeText->setText(
+            "Selected: " + QString::number(begin * length) + " - " +
+            QString::number(end * length)
+        );
+    }
+}
+
+void ScaleWidget::clearSelectedRange() {
+    _selectedRange = std::pair(0.0, 0.0);
+    delete _selectedRangeItem;
+    _selectedRangeItem = nullptr;
+    _selectedRangeText->setText("Shift + drag to select a time range");
+}
+
+void ScaleWidget::setDiffOverlay(const SessionRecording* other, const SessionDiff& diff) {
+    if (!_recording)  return;
+
+    clearDiffOverlay();
+
+    const double length = _recording->recordingLength;
+    const ChannelCurve& channel = _recording->curve(_channel);
+    auto toScene = [length, &channel](double time, double value) {
+        return QPointF(time / length, channel.normalize(value));
+    };
+
+    // The curve of the other recording is normalized against its own length, so it has
+    // to be brought into the range of this recording
+    QPainterPath curve;
+    const ChannelCurve& otherChannel = other->curve(_channel);
+    for (size_t i = 0; i < otherChannel.linearized.size(); i += 1) {
+        size_t index = otherChannel.linearized[i];
+        double time = other->curveTimes[index] * other->recordingLength;
+        double value = otherChannel.values[index];
+        if (i == 0)  curve.moveTo(toScene(time, value));
+        else  curve.lineTo(toScene(time, value));
+    }
+
+    QPainterPath markers;
+    if (_channel == Channel::Scale) {
+        for (const ScaleDifference& d : diff.scaleDifferences) {
+            markers.moveTo(toScene(d.recordingTime, d.first));
+            markers.lineTo(toScene(d.recordingTime, d.second));
+        }
+    }
+
+    QPen curvePen;
+    curvePen.setColor(Qt::cyan);
+    curvePen.setWidthF(0.0025f);
+    _diffCurve = _scene->addPath(curve, curvePen);
+    _diffCurve->setZValue(0);
+
+    QPen markerPen;
+    markerPen.setColor(Qt::red);
+    markerPen.setWidthF(0.0025f);
+    _diffMarkers = _scene->addPath(markers, markerPen);
+    _diffMarkers->setZValue(0);
+}
+
+void ScaleWidget::clearDiffOverlay() {
+    delete _diffCurve;
+    _diffCurve = nullptr;
+    delete _diffMarkers;
+    _diffMarkers = nullptr;
+}
+
+void ScaleWidget::searchScripts() {
+    delete _searchMarkers;
+    _searchMarkers = nullptr;
+    delete _searchCurrent;
+    _searchCurrent = nullptr;
+    _searchResults.clear();
+    _currentSearchResult = 0;
+    _searchResultText->clear();
+
+    if (!_recording)  return;
+
+    std::string query = _searchText->text().toStdString();
+    if (query.empty())  return;
+    if (query.size() < MinimumQueryLength) {
+        _searchResultText->setText(
+            "Enter at least " + QString::number(MinimumQueryLength) + " characters"
+        );
+        return;
+    }
+
+    const ScriptIndex& index = _recording->scriptIndex;
+    _searchResults = searchScriptIndex(index, query);
+    if (_searchResults.empty()) {
+        _searchResultText->setText("No matches");
+        return;
+    }
+
+    QPainterPath markers;
+    for (size_t i : _searchResults) {
+        double x = index.keyframes[i]->recordingTime / _recording->recordingLength;
+        markers.moveTo(x, 0.0);
+        markers.lineTo(x, 1.0);
+    }
+
+    QPen pen;
+    pen.setColor(Qt::green);
+    pen.setWidthF(0.0025f);
+    _searchMarkers = _scene->addPath(markers, pen);
+    _searchMarkers->setZValue(0);
+
+    showSearchResult(0);
+}
+
+void ScaleWidget::showSearchResult(size_t index) {
+    if (!_recording || _searchResults.empty())  return;
+
+    _currentSearchResult = index % _searchResults.size();
+    const KeyframeScript* kf =
+        _recording->scriptIndex.keyframes[_searchResults[_currentSearchResult]];
+    double x = kf->recordingTime / _recording->recordingLength;
+
+    QPainterPath marker;
+    marker.moveTo(x, 0.0);
+    marker.lineTo(x, 1.0);
+
+    delete _searchCurrent;
+    QPen pen;
+    pen.setColor(Qt::magenta);
+    pen.setWidthF(0.005f);
+    _searchCurrent = _scene->addPath(marker, pen);
+    _searchCurrent->setZValue(0);
+
+    _searchResultText->setText(
+        QString::number(_currentSearchResult + 1) + " / " +
+        QString::number(_searchResults.size()) + " at " +
+        QString::number(kf->recordingTime) + ": " + QString::fromStdString(kf->script)
+    );
+}
+
+void ScaleWidget::applySpeedToSelectedRange() {
+    if (!_recording || _selectedRange.first >= _selectedRange.second)  return;
+
+    bool ok = false;
+    double speed = _speedFactor->text().toDouble(&ok);
+    if (!ok || speed <= 0.0)  return;
+
+    double length = _recording->recordingLength;
+    retimeRange(_selectedRange.first * length, _selectedRange.second * length, speed);
+}
+
+void ScaleWidget::cutSelectedRange() {
+    if (!_recording || _selectedRange.first >= _selectedRange.second)  return;
+
+    double length = _recording->recordingLength;
+    cutRange(_selectedRange.first * length, _selectedRange.second * length);
+}
+
+void ScaleWidget::retimeRange(double begin, double end, double speed) {
+    // Commit the current curve before the keyframe times are changed underneath it
+    updateSessionRecording();
+    retimeSessionRecording(_recording, begin, end, speed);
+    setSessionRecording(_recording);
+
+    JournalEntry entry;
+    entry.kind = JournalEntry::Kind::Retime;
+    entry.range = std::pair(begin, end);
+    entry.speed = speed;
+    appendToJournal(entry);
+}
+
+void ScaleWidget::cutRange(double begin, double end) {
+    updateSessionRecording();
+    bool success = cutSessionRecording(_recording, begin, end);
+    if (!success) {
+        QMessageBox::critical(this, "Error cutting session recording",
+            "Could not cut the selected range. Not enough camera keyframes would remain"
+        );
+        return;
+    }
+    setSessionRecording(_recording);
+
+    JournalEntry entry;
+    entry.kind = JournalEntry::Kind::Cut;
+    entry.range = std::pair(begin, end);
+    appendToJournal(entry);
+}
+
+void ScaleWidget::setProfilingOverlayVisible(bool visible) {
+    if (visible && !isProfilingEnabled()) {
+        setProfilingEnabled(true);
+        _hasEnabledProfiling = true;
+    }
+    else if (!visible && _hasEnabledProfiling) {
+        setProfilingEnabled(false);
+        _hasEnabledProfiling = false;
+    }
+    _profilingOverlay->setVisible(visible);
+    if (visible) {
+        updateProfilingOverlay();
+        _profilingTimer->start(250);
+    }
+    else {
+        _profilingTimer->stop();
+    }
+}
+
+void ScaleWidget::updateProfilingOverlay() {
+    _profilingOverlay->setText(QString::fromStdString(profilingSummary()));
+    _profilingOverlay->adjustSize();
+}
+
+void ScaleWidget::requestFilterPreview() {
+    _filterRadiusText->setText("Radius: " + QString::number(_filterRadius->value()));
+    if (!_recording)  return;
+
+    // Moved points are part of the curve that is filtered
+    updateSessionRecording();
+
+    // Only one preview is computed at a time. If the settings change in the meantime, the
+    // next preview is started as soon as the current one is done
+    _isFilterPreviewRequested = true;
+    if (_isFilterPreviewRunning)  return;
+
+    _isFilterPreviewRequested = false;
+    const int radius = _filterRadius->value();
+    if (radius == 0) {
+        delete _filterPreview;
+        _filterPreview = nullptr;
+        return;
+    }
+
+    if (!_filterInput) {
+        std::vector<std::vector<double>> input;
+        if (isOrientationChannel(_channel)) {
+            input.push_back(_recording->curve(Channel::OrientationW).values);
+            input.push_back(_recording->curve(Channel::OrientationX).values);
+            input.push_back(_recording->curve(Channel::OrientationY).values);
+            input.push_back(_recording->curve(Channel::OrientationZ).values);
+        }
+        else {
+            input.push_back(_recording->curve(_channel).values);
+        }
+        _filterInput = std::make_shared<const std::vector<std::vector<double>>>(
+            std::move(input)
+        );
+    }
+
+    if (_filterWorker.joinable())  _filterWorker.join();
+    _isFilterPreviewRunning = true;
+
+    const Filter filter = static_cast<Filter>(_filterSelection->currentIndex());
+    const Channel channel = _channel;
+    std::shared_ptr<const std::vector<std::vector<double>>> input = _filterInput;
+    _filterWorker = std::thread([this, input, filter, channel, radius]() {
+        std::vector<double> result;
+        if (isOrientationChannel(channel)) {
+            std::array<std::vector<double>, 4> q = filterOrientation(
+                { &(*input)[0], &(*input)[1], &(*input)[2], &(*input)[3] }, filter, radius
+            );
+            size_t component = static_cast<size_t>(channel) -
+                static_cast<size_t>(Channel::OrientationW);
+            result = std::move(q[component]);
+        }
+        else {
+            result = filterValues((*input)[0], filter, radius);
+        }
+
+        QMetaObject::invokeMethod(
+            this,
+            [this, input, result = std::move(result)]() {
+                _isFilterPreviewRunning = false;
+                if (_isFilterPreviewRequested || input != _filterInput) {
+                    // The result is already outdated
+                    requestFilterPreview();
+                    return;
+                }
+
+                delete _filterPreview;
+                QPen pen;
+                pen.setColor(Qt::yellow);
+                pen.setWidthF(0.0025f);
+                _filterPreview = _scene->addPath(
+                    curvePath(_recording->curveTimes, result, _recording->curve(_channel)),
+                    pen
+                );
+                _filterPreview->setZValue(0);
+            },
+            Qt::QueuedConnection
+        );
+    });
+}
+
+void ScaleWidget::applyFilter() {
+    const int radius = _filterRadius->value();
+    if (!_recording || radius == 0)  return;
+
+    // Resetting the radius first removes the preview, which would be outdated anyway
+    _filterRadius->setValue(0);
+    filterChannel(static_cast<Filter>(_filterSelection->currentIndex()), radius);
+}
+
+void ScaleWidget::filterChannel(Filter filter, int radius) {
+    updateSessionRecording();
+
+    std::vector<KeyframeCamera*>& keyframes = _recording->curveKeyframes;
+    if (isOrientationChannel(_channel)) {
+        std::array<std::vector<double>, 4> q = filterOrientation(
+            {
+                &_recording->curve(Channel::OrientationW).values,
+                &_recording->curve(Channel::OrientationX).values,
+                &_recording->curve(Channel::OrientationY).values,
+                &_recording->curve(Channel::OrientationZ).values
+            },
+            filter, radius
+        );
+        for (size_t i = 0; i < keyframes.size(); i += 1) {
+            keyframes[i]->orientationW = q[0][i];
+            keyframes[i]->orientationX = q[1][i];
+            keyframes[i]->orientationY = q[2][i];
+            keyframes[i]->orientationZ = q[3][i];
+        }
+        updateChannelCurve(_recording, Channel::OrientationW);
+        updateChannelCurve(_recording, Channel::OrientationX);
+        updateChannelCurve(_recording, Channel::OrientationY);
+        updateChannelCurve(_recording, Channel::OrientationZ);
+    }
+    else {
+        std::vector<double> values = filterValues(
+            _recording->curve(_channel).values, filter, radius
+        );
+        for (size_t i = 0; i < keyframes.size(); i += 1) {
+            setChannelValue(keyframes[i], _channel, values[i]);
+        }
+        updateChannelCurve(_recording, _channel);
+    }
+
+    rebuildItems();
+
+    JournalEntry entry;
+    entry.kind = JournalEntry::Kind::Filter;
+    entry.filter = filter;
+    entry.radius = radius;
+    appendToJournal(entry);
+}
+
+void ScaleWidget::setJournal(EditJournal* journal) {
+    _journal = journal;
+}
+
+void ScaleWidget::appendToJournal(const JournalEntry& entry) {
+    if (!_journal || _journal->append(entry))  return;
+
+    // Entries are appended in the middle of edits, which must not be interrupted by the
+    // event loop of a dialog
+    QMetaObject::invokeMethod(
+        this,
+        [this]() {
+            QMessageBox::warning(this, "Error writing edit journal",
+                "Could not create the edit journal beside the recording. Edits will not "
+                "be restored after a crash"
+            );
+        },
+        Qt::QueuedConnection
+    );
+}
+
+void ScaleWidget::replayJournal(Channel channel, const std::vector<JournalEntry>& entries) {
+    if (!_recording)  return;
+    ScopedTimer timer("ScaleWidget::replayJournal");
+
+    // The replayed edits are already part of the journal
+    EditJournal* journal = _journal;
+    _journal = nullptr;
+
+    _channelSelection->setCurrentIndex(static_cast<int>(channel));
+    for (const JournalEntry& entry : entries) {
+        switch (entry.kind) {
+            case JournalEntry::Kind::Channel:
+                _channelSelection->setCurrentIndex(static_cast<int>(entry.channel));
+                break;
+            case JournalEntry::Kind::Move:
+            {
+                std::vector<ScaleItem*>::iterator it = std::lower_bound(
+                    _items.begin(), _items.end(), entry.index,
+                    [](ScaleItem* item, size_t i) { return item->_index < i; }
+                );
+                if (it != _items.end() && (*it)->_index == entry.index) {
+                    moveItem(*it, entry.y);
+                }
+                break;
+            }
+            case JournalEntry::Kind::Insert:
+                if (entry.index < _recording->curveTimes.size()) {
+                    insertItem(entry.index, entry.y);
+                }
+                break;
+            case JournalEntry::Kind::Rescale:
+                rescaleItemsTo(entry.range);
+                break;
+            case JournalEntry::Kind::Commit:
+                updateSessionRecording();
+                break;
+            case JournalEntry::Kind::Filter:
+                filterChannel(entry.filter, entry.radius);
+                break;
+            case JournalEntry::Kind::Retime:
+                retimeRange(entry.range.first, entry.range.second, entry.speed);
+                break;
+            case JournalEntry::Kind::Cut:
+                cutRange(entry.range.first, entry.range.second);
+                break;
+        }
+    }
+
+    _journal = journal;
 }
 
 void ScaleWidget::dragEnterEvent(QDragEnterEvent* event) {
@@ -5,26 +5,37 @@
 #include <QGraphicsItem>
 #include <QGraphicsView>
 
-struct KeyframeCamera;
+#include "curve.h"
+#include <memory>
+#include <thread>
+
+class EditJournal;
 class MainWindow;
+class QComboBox;
+class QGraphicsPathItem;
+class QGraphicsRectItem;
 class QGraphicsScene;
 class QGraphicsView;
 class QLabel;
 class QLineEdit;
 class QResizeEvent;
 class QSlider;
+class QTimer;
 class ScaleWidget;
+struct JournalEntry;
+struct SessionDiff;
 struct SessionRecording;
 
 struct ScaleItem : public QGraphicsItem {
-    ScaleItem(KeyframeCamera* kf, SessionRecording* recording, QColor color = Qt::white, double size = 10.0);
+    ScaleItem(size_t index, SessionRecording* recording, QColor color = Qt::white, double size = 10.0);
 
     virtual QRectF boundingRect() const override;
 
     virtual void paint(QPainter* painter, const QStyleOptionGraphicsItem* option,
         QWidget* widget) override;
 
-    KeyframeCamera* _keyframe;
+    // Index into the curve arrays of the recording
+    size_t _index;
     SessionRecording* _recording = nullptr;
     QGraphicsLineItem* _leftLine = nullptr;
     QGraphicsLineItem* _rightLine = nullptr;
@@ -51,22 +62,79 @@ public:
     SessionRecording* _recording = nullptr;
 
     ScaleItem* _pickedItem = nullptr;
+    // The position of the picked item before it was dragged
+    double _pickedItemY = 0.0;
+
+    // Shift + drag selects a time range; this is where the drag started
+    bool _isSelectingRange = false;
+    double _rangeAnchor = 0.0;
 };
 
 class ScaleWidget : public QWidget {
 Q_OBJECT
 public:
     ScaleWidget(MainWindow* mainWindow, QWidget* parent = nullptr);
+    ~ScaleWidget();
 
     void setSessionRecording(SessionRecording* recording);
+
+    // Writes the edits of the shown channel into the keyframes. The change at each point
+    // is interpolated across the keyframes between the points
     void updateSessionRecording();
 
+    // Recreates the points and lines of the shown channel from the recording
+    void rebuildItems();
+
+    // Moves the point to the normalized value 'y'
+    void moveItem(ScaleItem* item, double y);
+    // Adds a point for the camera keyframe with the index at the normalized value 'y'
+    void insertItem(size_t index, double y);
+    // Moves all points so that the current value range is shown as 'newMinMax'
+    void rescaleItemsTo(std::pair<double, double> newMinMax);
+
+    // The selected range is provided in normalized [0, 1] timeline coordinates
+    void setSelectedRange(double begin, double end);
+    void clearSelectedRange();
+
+    // Shows the curve of the other recording for the shown channel. If the scale is shown,
+    // the keyframes at which the scale differs are marked
+    void setDiffOverlay(const SessionRecording* other, const SessionDiff& diff);
+    void clearDiffOverlay();
+
+    // Enables profiling while the overlay with the timers and counters is shown
+    void setProfilingOverlayVisible(bool visible);
+
+    // Filtering the shown channel
+    void requestFilterPreview();
+    void applyFilter();
+    void filterChannel(Filter filter, int radius);
+
+    // The range is provided in recording time
+    void retimeRange(double begin, double end, double speed);
+    void cutRange(double begin, double end);
+
+    // Marks all scripts that contain the text of the search box on the timeline
+    void searchScripts();
+    // Highlights the search result with the provided index, wrapping around at the ends
+    void showSearchResult(size_t index);
+
+    // All following edits are written to the journal
+    void setJournal(EditJournal* journal);
+    void appendToJournal(const JournalEntry& entry);
+    // Applies the edits of a journal that was loaded for the current recording, starting
+    // with the provided channel
+    void replayJournal(Channel channel, const std::vector<JournalEntry>& entries);
+
     virtual void dragEnterEvent(QDragEnterEvent* event) override;
     virtual void dropEvent(QDropEvent* event) override;
     virtual void resizeEvent(QResizeEvent* event) override;
 
 public slots:
     void rescaleItems();
+    void applySpeedToSelectedRange();
+    void cutSelectedRange();
+    void updateProfilingOverlay();
+    void selectChannel(int index);
 
 public:
     MainWindow* _mainWindow;
@@ -79,6 +147,45 @@ public:
     QSlider* _maxValue;
     QLabel* _maxValueText;
 
+    QLabel* _selectedRangeText;
+    QLineEdit* _speedFactor;
+    QGraphicsRectItem* _selectedRangeItem = nullptr;
+    std::pair<double, double> _selectedRange = { 0.0, 0.0 };
+
+    QGraphicsPathItem* _diffCurve = nullptr;
+    QGraphicsPathItem* _diffMarkers = nullptr;
+
+    QLabel* _profilingOverlay;
+    QTimer* _profilingTimer;
+    // Profiling that was already enabled by '--trace' has to stay on with the overlay hidden
+    bool _hasEnabledProfiling = false;
+
+    QComboBox* _channelSelection;
+    QComboBox* _filterSelection;
+    QSlider* _filterRadius;
+    QLabel* _filterRadiusText;
+    QGraphicsPathItem* _filterPreview = nullptr;
+
+    // The values that the preview is computed from. This is one vector for most channels
+    // and all four components for the orientation channels. It is shared with the worker
+    // thread and recreated whenever the curve changes
+    std::shared_ptr<const std::vector<std::vector<double>>> _filterInput;
+    std::thread _filterWorker;
+    bool _isFilterPreviewRunning = false;
+    bool _isFilterPreviewRequested = false;
+
+    QLineEdit* _searchText;
+    QLabel* _searchResultText;
+    QGraphicsPathItem* _searchMarkers = nullptr;
+    QGraphicsPathItem* _searchCurrent = nullptr;
+    // Indices into the script index of the recording
+    std::vector<size_t> _searchResults;
+    size_t _currentSearchResult = 0;
+
+    Channel _channel = Channel::Scale;
+    bool _hasEdits = false;
+    EditJournal* _journal = nullptr;
+
     std::vector<ScaleItem*> _items;
     SessionRecording* _recording = nullptr;
 };
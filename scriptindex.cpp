@@ -0,0 +1,136 @@
+#include "scriptindex.h"
+
+#include "parallel.h"
+#include "profiling.h"
+#include "sessionrecording.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+    // Extracting the trigrams is cheap per script, so chunks should not be too small
+    constexpr const size_t MinimumChunkSize = 1024;
+
+    char toLower(char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    uint32_t trigram(const char* c) {
+        return static_cast<uint32_t>(static_cast<unsigned char>(toLower(c[0]))) << 16 |
+            static_cast<uint32_t>(static_cast<unsigned char>(toLower(c[1]))) << 8 |
+            static_cast<uint32_t>(static_cast<unsigned char>(toLower(c[2])));
+    }
+
+    // Replaces the content of 'res' with the sorted, distinct trigrams of the text
+    void distinctTrigrams(std::string_view text, std::vector<uint32_t>& res) {
+        res.clear();
+        for (size_t i = 0; i + 3 <= text.size(); i += 1) {
+            res.push_back(trigram(text.data() + i));
+        }
+        std::sort(res.begin(), res.end());
+        res.erase(std::unique(res.begin(), res.end()), res.end());
+    }
+} // namespace
+
+ScriptIndex createScriptIndex(const std::vector<Keyframe*>& keyframes) {
+    ScopedTimer timer("createScriptIndex");
+    ScriptIndex res;
+    for (const Keyframe* kf : keyframes) {
+        if (kf->type == Keyframe::Type::Script) {
+            res.keyframes.push_back(static_cast<const KeyframeScript*>(kf));
+        }
+    }
+
+    // Every chunk collects the sorted (trigram, script) pairs of its scripts. As the
+    // chunks are in script order, the lists can then be merged into one sorted list
+    using Entry = std::pair<uint32_t, uint32_t>;
+    const size_t n = res.keyframes.size();
+    const size_t nChunks = parallelChunkCount(n, MinimumChunkSize);
+    std::vector<std::vector<Entry>> chunks(nChunks);
+    parallelForChunks(n, nChunks,
+        [&res, &chunks](size_t chunk, size_t begin, size_t end) {
+            std::vector<Entry>& entries = chunks[chunk];
+            std::vector<uint32_t> trigrams;
+            for (size_t i = begin; i < end; i += 1) {
+                distinctTrigrams(res.keyframes[i]->script, trigrams);
+                for (uint32_t t : trigrams) {
+                    entries.emplace_back(t, static_cast<uint32_t>(i));
+                }
+            }
+            std::sort(entries.begin(), entries.end());
+        }
+    );
+
+    std::vector<Entry> entries = std::move(chunks[0]);
+    for (size_t i = 1; i < nChunks; i += 1) {
+        size_t middle = entries.size();
+        entries.insert(entries.end(), chunks[i].begin(), chunks[i].end());
+        std::inplace_merge(entries.begin(), entries.begin() + middle, entries.end());
+    }
+
+    res.postings.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); i += 1) {
+        if (i == 0 || entries[i].first != entries[i - 1].first) {
+            res.trigrams.push_back(entries[i].first);
+            res.offsets.push_back(static_cast<uint32_t>(i));
+        }
+        res.postings.push_back(entries[i].second);
+    }
+    res.offsets.push_back(static_cast<uint32_t>(entries.size()));
+
+    return res;
+}
+
+std::vector<size_t> searchScriptIndex(const ScriptIndex& index, std::string_view query) {
+    ScopedTimer timer("searchScriptIndex");
+    if (query.size() < MinimumQueryLength)  return {};
+
+    std::vector<uint32_t> trigrams;
+    distinctTrigrams(query, trigrams);
+
+    // A script can only match if it contains every trigram of the query
+    std::vector<std::pair<const uint32_t*, const uint32_t*>> lists;
+    for (uint32_t t : trigrams) {
+        std::vector<uint32_t>::const_iterator it =
+            std::lower_bound(index.trigrams.begin(), index.trigrams.end(), t);
+        if (it == index.trigrams.end() || *it != t)  return {};
+
+        size_t i = it - index.trigrams.begin();
+        lists.emplace_back(
+            index.postings.data() + index.offsets[i],
+            index.postings.data() + index.offsets[i + 1]
+        );
+    }
+
+    // Starting with the shortest list keeps the intermediate results small
+    std::sort(
+        lists.begin(), lists.end(),
+        [](const std::pair<const uint32_t*, const uint32_t*>& lhs,
+           const std::pair<const uint32_t*, const uint32_t*>& rhs)
+        {
+            return lhs.second - lhs.first < rhs.second - rhs.first;
+        }
+    );
+    std::vector<uint32_t> candidates(lists[0].first, lists[0].second);
+    std::vector<uint32_t> intersection;
+    for (size_t i = 1; i < lists.size() && !candidates.empty(); i += 1) {
+        intersection.clear();
+        std::set_intersection(
+            candidates.begin(), candidates.end(), lists[i].first, lists[i].second,
+            std::back_inserter(intersection)
+        );
+        candidates.swap(intersection);
+    }
+
+    // The trigrams might appear at different places in the script, so the candidates
+    // still have to be checked for the whole query
+    std::vector<size_t> res;
+    for (uint32_t c : candidates) {
+        const std::string& script = index.keyframes[c]->script;
+        std::string::const_iterator it = std::search(
+            script.begin(), script.end(), query.begin(), query.end(),
+            [](char lhs, char rhs) { return toLower(lhs) == toLower(rhs); }
+        );
+        if (it != script.end())  res.push_back(c);
+    }
+    return res;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+struct Keyframe;
+struct KeyframeScript;
+
+// Trigram index over the scripts of a recording. Every distinct three-character sequence
+// of a script (ignoring case) maps to the list of scripts that contain it, so a query only
+// has to look at the scripts that contain all of its trigrams
+struct ScriptIndex {
+    // All script keyframes in the order of the recording
+    std::vector<const KeyframeScript*> keyframes;
+
+    // Sorted trigrams. The scripts that contain trigrams[i] are
+    // postings[offsets[i]] .. postings[offsets[i + 1]], ordered by their index
+    std::vector<uint32_t> trigrams;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> postings;
+};
+
+// Queries need at least this many characters to be looked up in the index
+constexpr const size_t MinimumQueryLength = 3;
+
+ScriptIndex createScriptIndex(const std::vector<Keyframe*>& keyframes);
+
+// Returns the indices into ScriptIndex::keyframes of all scripts that contain the query
+// without regard to case. Queries that are shorter than MinimumQueryLength return nothing
+std::vector<size_t> searchScriptIndex(const ScriptIndex& index, std::string_view query);
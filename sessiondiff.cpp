@@ -0,0 +1,338 @@
+#include "sessiondiff.h"
+
+#include "parallel.h"
+#include "profiling.h"
+#include "sessionrecording.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace {
+    // Struct-of-arrays copy of the aligned camera keyframes so that the comparison
+    // kernel only streams through the values it actually needs
+    struct CameraColumns {
+        void reserve(size_t n) {
+            for (std::vector<double>* c : columns())  c->reserve(n);
+            keyframes.reserve(n);
+        }
+
+        void push(const KeyframeCamera* kf) {
+            time.push_back(kf->recordingTime);
+            posX.push_back(kf->posX);
+            posY.push_back(kf->posY);
+            posZ.push_back(kf->posZ);
+            orientationW.push_back(kf->orientationW);
+            orientationX.push_back(kf->orientationX);
+            orientationY.push_back(kf->orientationY);
+            orientationZ.push_back(kf->orientationZ);
+            scale.push_back(kf->scale);
+            keyframes.push_back(kf);
+        }
+
+        std::vector<std::vector<double>*> columns() {
+            return {
+                &time, &posX, &posY, &posZ, &orientationW, &orientationX, &orientationY,
+                &orientationZ, &scale
+            };
+        }
+
+        std::vector<double> time;
+        std::vector<double> posX;
+        std::vector<double> posY;
+        std::vector<double> posZ;
+        std::vector<double> orientationW;
+        std::vector<double> orientationX;
+        std::vector<double> orientationY;
+        std::vector<double> orientationZ;
+        std::vector<double> scale;
+        std::vector<const KeyframeCamera*> keyframes;
+    };
+
+    template <typename T>
+    std::vector<const T*> keyframesOfType(const SessionRecording* recording,
+                                          Keyframe::Type type)
+    {
+        std::vector<const T*> res;
+        for (const Keyframe* kf : recording->keyframes) {
+            if (kf->type == type)  res.push_back(static_cast<const T*>(kf));
+        }
+        return res;
+    }
+
+    // Walks both time-ordered lists in lockstep and pairs up keyframes whose recording
+    // times are within the tolerance. Keyframes without a partner are reported through
+    // the diff
+    template <typename T>
+    std::vector<std::pair<const T*, const T*>> align(const std::vector<const T*>& first,
+                                                     const std::vector<const T*>& second,
+                                                     double tolerance, SessionDiff& diff)
+    {
+        std::vector<std::pair<const T*, const T*>> res;
+        res.reserve(std::min(first.size(), second.size()));
+
+        auto onlyIn = [&diff](const T* kf, KeyframeDiff::Kind kind) {
+            KeyframeDiff d;
+            d.kind = kind;
+            d.recordingTime = kf->recordingTime;
+            diff.keyframes.push_back(d);
+            if (kind == KeyframeDiff::Kind::OnlyInFirst)  diff.nOnlyInFirst += 1;
+            else  diff.nOnlyInSecond += 1;
+        };
+
+        size_t i = 0;
+        size_t j = 0;
+        while (i < first.size() && j < second.size()) {
+            double delta = first[i]->recordingTime - second[j]->recordingTime;
+            if (std::abs(delta) <= tolerance) {
+                res.emplace_back(first[i], second[j]);
+                i += 1;
+                j += 1;
+            }
+            else if (delta < 0.0) {
+                onlyIn(first[i], KeyframeDiff::Kind::OnlyInFirst);
+                i += 1;
+            }
+            else {
+                onlyIn(second[j], KeyframeDiff::Kind::OnlyInSecond);
+                j += 1;
+            }
+        }
+        for (; i < first.size(); i += 1)  onlyIn(first[i], KeyframeDiff::Kind::OnlyInFirst);
+        for (; j < second.size(); j += 1)  onlyIn(second[j], KeyframeDiff::Kind::OnlyInSecond);
+
+        return res;
+    }
+
+    void accumulate(ChannelDiff& channel, double difference, double tolerance,
+                    double time)
+    {
+        if (difference <= tolerance)  return;
+
+        channel.nDifferent += 1;
+        if (difference > channel.maxDifference) {
+            channel.maxDifference = difference;
+            channel.maxDifferenceTime = time;
+        }
+    }
+
+    void merge(ChannelDiff& channel, const ChannelDiff& other) {
+        channel.nDifferent += other.nDifferent;
+        if (other.maxDifference > channel.maxDifference) {
+            channel.maxDifference = other.maxDifference;
+            channel.maxDifferenceTime = other.maxDifferenceTime;
+        }
+    }
+
+    std::string channelSummary(const std::string& name, const ChannelDiff& channel,
+                               bool hasMagnitude)
+    {
+        std::ostringstream s;
+        s << name << ": " << channel.nDifferent << " differing";
+        if (hasMagnitude && channel.nDifferent > 0) {
+            s << ", max " << channel.maxDifference << " at " << channel.maxDifferenceTime;
+        }
+        s << '\n';
+        return s.str();
+    }
+} // namespace
+
+bool SessionDiff::isEqual() const {
+    return nOnlyInFirst == 0 && nOnlyInSecond == 0 && position.nDifferent == 0 &&
+        orientation.nDifferent == 0 && scale.nDifferent == 0 &&
+        followNode.nDifferent == 0 && script.nDifferent == 0;
+}
+
+SessionDiff diffSessionRecordings(const SessionRecording* first,
+                                  const SessionRecording* second,
+                                  const DiffTolerances& tolerances)
+{
+    ScopedTimer timer("diffSessionRecordings");
+    SessionDiff res;
+
+    //
+    // Camera keyframes
+    std::vector<std::pair<const KeyframeCamera*, const KeyframeCamera*>> cameras = align(
+        keyframesOfType<KeyframeCamera>(first, Keyframe::Type::Camera),
+        keyframesOfType<KeyframeCamera>(second, Keyframe::Type::Camera),
+        tolerances.time,
+        res
+    );
+    res.nAlignedCameras = cameras.size();
+
+    CameraColumns a;
+    CameraColumns b;
+    a.reserve(cameras.size());
+    b.reserve(cameras.size());
+    for (const std::pair<const KeyframeCamera*, const KeyframeCamera*>& p : cameras) {
+        a.push(p.first);
+        b.push(p.second);
+    }
+
+    const size_t n = cameras.size();
+    std::vector<double> position(n);
+    std::vector<double> orientation(n);
+    std::vector<double> scale(n);
+    std::vector<char> followNode(n);
+
+    struct Partial {
+        ChannelDiff position;
+        ChannelDiff orientation;
+        ChannelDiff scale;
+        ChannelDiff followNode;
+    };
+    const size_t nChunks = parallelChunkCount(n);
+    std::vector<Partial> partials(nChunks);
+    parallelForChunks(n, nChunks,
+        [&](size_t chunk, size_t begin, size_t end) {
+            Partial& p = partials[chunk];
+            for (size_t i = begin; i < end; i += 1) {
+                double dx = a.posX[i] - b.posX[i];
+                double dy = a.posY[i] - b.posY[i];
+                double dz = a.posZ[i] - b.posZ[i];
+                position[i] = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+                // The recorded quaternions are not exactly unit length and acos loses
+                // precision close to 1, so the angle is computed from the difference
+                // and the sum of the normalized quaternions instead. atan2 of those is a
+                // quarter of the rotation angle. q and -q are the same orientation, hence
+                // the shorter of both is used
+                double la = std::sqrt(
+                    a.orientationW[i] * a.orientationW[i] +
+                    a.orientationX[i] * a.orientationX[i] +
+                    a.orientationY[i] * a.orientationY[i] +
+                    a.orientationZ[i] * a.orientationZ[i]
+                );
+                double lb = std::sqrt(
+                    b.orientationW[i] * b.orientationW[i] +
+                    b.orientationX[i] * b.orientationX[i] +
+                    b.orientationY[i] * b.orientationY[i] +
+                    b.orientationZ[i] * b.orientationZ[i]
+                );
+                double dw = a.orientationW[i] / la - b.orientationW[i] / lb;
+                double dqx = a.orientationX[i] / la - b.orientationX[i] / lb;
+                double dqy = a.orientationY[i] / la - b.orientationY[i] / lb;
+                double dqz = a.orientationZ[i] / la - b.orientationZ[i] / lb;
+                double sw = a.orientationW[i] / la + b.orientationW[i] / lb;
+                double sx = a.orientationX[i] / la + b.orientationX[i] / lb;
+                double sy = a.orientationY[i] / la + b.orientationY[i] / lb;
+                double sz = a.orientationZ[i] / la + b.orientationZ[i] / lb;
+                double difference = std::sqrt(dw * dw + dqx * dqx + dqy * dqy + dqz * dqz);
+                double sum = std::sqrt(sw * sw + sx * sx + sy * sy + sz * sz);
+                orientation[i] = 4.0 * std::atan2(
+                    std::min(difference, sum), std::max(difference, sum)
+                );
+
+                scale[i] = std::abs(a.scale[i] - b.scale[i]);
+
+                const KeyframeCamera* ka = a.keyframes[i];
+                const KeyframeCamera* kb = b.keyframes[i];
+                followNode[i] = ka->shouldFollow != kb->shouldFollow ||
+                    ka->followNode != kb->followNode;
+
+                accumulate(p.position, position[i], tolerances.position, a.time[i]);
+                accumulate(
+                    p.orientation, orientation[i], tolerances.orientation, a.time[i]
+                );
+                accumulate(p.scale, scale[i], tolerances.scale, a.time[i]);
+                accumulate(p.followNode, followNode[i], 0.0, a.time[i]);
+            }
+        }
+    );
+    for (const Partial& p : partials) {
+        merge(res.position, p.position);
+        merge(res.orientation, p.orientation);
+        merge(res.scale, p.scale);
+        merge(res.followNode, p.followNode);
+    }
+
+    for (size_t i = 0; i < n; i += 1) {
+        bool positionChanged = position[i] > tolerances.position;
+        bool orientationChanged = orientation[i] > tolerances.orientation;
+        bool scaleChanged = scale[i] > tolerances.scale;
+        if (!positionChanged && !orientationChanged && !scaleChanged && !followNode[i]) {
+            continue;
+        }
+
+        KeyframeDiff d;
+        d.kind = KeyframeDiff::Kind::Changed;
+        d.recordingTime = a.time[i];
+        d.position = position[i];
+        d.orientation = orientation[i];
+        d.scale = scale[i];
+        d.followNodeChanged = followNode[i];
+        res.keyframes.push_back(d);
+
+        if (scaleChanged) {
+            res.scaleDifferences.push_back({ a.time[i], a.scale[i], b.scale[i] });
+        }
+    }
+
+    //
+    // Script keyframes
+    std::vector<std::pair<const KeyframeScript*, const KeyframeScript*>> scripts = align(
+        keyframesOfType<KeyframeScript>(first, Keyframe::Type::Script),
+        keyframesOfType<KeyframeScript>(second, Keyframe::Type::Script),
+        tolerances.time,
+        res
+    );
+    res.nAlignedScripts = scripts.size();
+    for (const std::pair<const KeyframeScript*, const KeyframeScript*>& p : scripts) {
+        if (p.first->script == p.second->script)  continue;
+
+        accumulate(res.script, 1.0, 0.0, p.first->recordingTime);
+        KeyframeDiff d;
+        d.kind = KeyframeDiff::Kind::Changed;
+        d.recordingTime = p.first->recordingTime;
+        d.scriptChanged = true;
+        res.keyframes.push_back(d);
+    }
+
+    std::stable_sort(
+        res.keyframes.begin(), res.keyframes.end(),
+        [](const KeyframeDiff& lhs, const KeyframeDiff& rhs) {
+            return lhs.recordingTime < rhs.recordingTime;
+        }
+    );
+
+    return res;
+}
+
+std::string diffSummary(const SessionDiff& diff) {
+    std::ostringstream s;
+    s << "Aligned keyframes: " << diff.nAlignedCameras << " camera, "
+        << diff.nAlignedScripts << " script\n";
+    s << "Only in first: " << diff.nOnlyInFirst << '\n';
+    s << "Only in second: " << diff.nOnlyInSecond << '\n';
+    s << channelSummary("Position", diff.position, true);
+    s << channelSummary("Orientation", diff.orientation, true);
+    s << channelSummary("Scale", diff.scale, true);
+    s << channelSummary("Follow node", diff.followNode, false);
+    s << channelSummary("Script", diff.script, false);
+    return s.str();
+}
+
+bool saveDiffReport(const SessionDiff& diff, std::filesystem::path path) {
+    std::ofstream f(path);
+    if (!f.good())  return false;
+
+    f.precision(17);
+    f << "# recordingTime kind position orientation scale followNode script\n";
+    for (const KeyframeDiff& d : diff.keyframes) {
+        f << d.recordingTime << ' ';
+        switch (d.kind) {
+            case KeyframeDiff::Kind::Changed:
+                f << "changed " << d.position << ' ' << d.orientation << ' ' << d.scale
+                    << ' ' << (d.followNodeChanged ? "changed" : "-") << ' '
+                    << (d.scriptChanged ? "changed" : "-") << '\n';
+                break;
+            case KeyframeDiff::Kind::OnlyInFirst:
+                f << "only-in-first\n";
+                break;
+            case KeyframeDiff::Kind::OnlyInSecond:
+                f << "only-in-second\n";
+                break;
+        }
+    }
+    return f.good();
+}
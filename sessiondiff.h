@@ -0,0 +1,65 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+struct SessionRecording;
+
+struct DiffTolerances {
+    // Keyframes whose recording times are closer than this are compared with each other
+    double time = 1e-3;
+    double position = 1e-3;
+    // Angle between the orientations in radians
+    double orientation = 1e-6;
+    double scale = 1e-9;
+};
+
+struct ChannelDiff {
+    size_t nDifferent = 0;
+    double maxDifference = 0.0;
+    double maxDifferenceTime = 0.0;
+};
+
+struct KeyframeDiff {
+    enum class Kind { Changed, OnlyInFirst, OnlyInSecond };
+    Kind kind;
+
+    double recordingTime;
+    double position = 0.0;
+    double orientation = 0.0;
+    double scale = 0.0;
+    bool followNodeChanged = false;
+    bool scriptChanged = false;
+};
+
+struct ScaleDifference {
+    double recordingTime;
+    double first;
+    double second;
+};
+
+struct SessionDiff {
+    size_t nAlignedCameras = 0;
+    size_t nAlignedScripts = 0;
+    size_t nOnlyInFirst = 0;
+    size_t nOnlyInSecond = 0;
+
+    ChannelDiff position;
+    ChannelDiff orientation;
+    ChannelDiff scale;
+    ChannelDiff followNode;
+    ChannelDiff script;
+
+    // Only the keyframes that differ, ordered by their recording time
+    std::vector<KeyframeDiff> keyframes;
+    std::vector<ScaleDifference> scaleDifferences;
+
+    bool isEqual() const;
+};
+
+SessionDiff diffSessionRecordings(const SessionRecording* first,
+    const SessionRecording* second, const DiffTolerances& tolerances);
+
+std::string diffSummary(const SessionDiff& diff);
+bool saveDiffReport(const SessionDiff& diff, std::filesystem::path path);
@@ -1,8 +1,16 @@
 #include "sessionrecording.h"
 
+#include "parallel.h"
+#include "profiling.h"
 #include <QMessageBox>
+#include <algorithm>
+#include <charconv>
 #include <fstream>
+#include <iostream>
+#include <memory>
+#include <queue>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace {
@@ -24,6 +32,28 @@ namespace {
         }
     }
 
+    constexpr const size_t WriteBufferSize = 4 * 1024 * 1024;
+
+    // Appends the value with the same fixed 20 digit precision that the stream-based
+    // writer used, followed by a separating space
+    void appendValue(std::string& buffer, double value) {
+        // Large enough for the fixed representation of any double
+        char buf[400];
+        std::to_chars_result res = std::to_chars(
+            buf, buf + sizeof(buf), value, std::chars_format::fixed, 20
+        );
+        assert(res.ec == std::errc());
+        buffer.append(buf, res.ptr);
+        buffer += ' ';
+    }
+
+    // Keyframe only has a virtual destructor in debug builds, so we have to delete through
+    // the concrete type
+    void deleteKeyframe(Keyframe* kf) {
+        if (kf->type == Keyframe::Type::Camera)  delete static_cast<KeyframeCamera*>(kf);
+        else  delete static_cast<KeyframeScript*>(kf);
+    }
+
     void removeEmpty(std::vector<std::string>* list) {
         for (size_t i = 0; i < list->size(); i += 1) {
             if (list->at(i).empty()) {
@@ -32,17 +62,164 @@ namespace {
             }
         }
     }
+
+    constexpr const std::string_view Header = "OpenSpace_record/playback01.00A";
+    constexpr const size_t ReadBufferSize = 1024 * 1024;
+    // Gap between concatenated recordings if the previous one has no keyframe spacing (60 Hz)
+    constexpr const double DefaultFrameSpacing = 1.0 / 60.0;
+
+    bool IsHeadless = false;
+
+    void reportError(const std::string& title, const std::string& message) {
+        if (IsHeadless) {
+            std::cerr << title << ": " << message << '\n';
+        }
+        else {
+            QMessageBox::critical(nullptr, QString::fromStdString(title),
+                QString::fromStdString(message)
+            );
+        }
+    }
+
+    // Writes recording lines through a buffer that is flushed to the file in large blocks
+    struct RecordingWriter {
+        RecordingWriter(const std::filesystem::path& path) : file(path) {
+            buffer.reserve(WriteBufferSize + 4096);
+        }
+        ~RecordingWriter() { flush(); }
+
+        void flushIfFull() {
+            if (buffer.size() >= WriteBufferSize)  flush();
+        }
+
+        void flush() {
+            addToCounter(Counter::BytesWritten, buffer.size());
+            file.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+
+        std::ofstream file;
+        std::string buffer;
+    };
+
+    // Stands in for an output file while it is written. The content goes into a temporary
+    // file beside the output that only replaces it once it is complete, so the output can
+    // also be one of the inputs and failures do not leave a partial output behind
+    struct TemporaryOutput {
+        TemporaryOutput(std::filesystem::path p) : path(std::move(p)), temporary(path) {
+            temporary += ".tmp";
+        }
+        ~TemporaryOutput() {
+            if (!isCommitted) {
+                std::error_code ec;
+                std::filesystem::remove(temporary, ec);
+            }
+        }
+
+        // All inputs have to be closed before, as the output might replace one of them
+        bool commit(RecordingWriter& writer) {
+            writer.flush();
+            writer.file.close();
+            if (!writer.file.good())  return false;
+
+            std::error_code ec;
+            std::filesystem::rename(temporary, path, ec);
+            isCommitted = !ec;
+            return isCommitted;
+        }
+
+        std::filesystem::path path;
+        std::filesystem::path temporary;
+        bool isCommitted = false;
+    };
+
+    // Reads a recording line by line through a large stream buffer and only parses the
+    // keyframe type and the three time values; the rest of the line is left untouched
+    struct RecordingReader {
+        RecordingReader(const std::filesystem::path& p)
+            : path(p)
+            , streamBuffer(ReadBufferSize)
+        {
+            file.rdbuf()->pubsetbuf(streamBuffer.data(), streamBuffer.size());
+            file.open(path);
+        }
+        ~RecordingReader() { addToCounter(Counter::BytesRead, nBytesRead); }
+
+        bool readHeader() {
+            std::getline(file, line);
+            if (line != Header) {
+                error = "Header of '" + path.string() + "' is not '" +
+                    std::string(Header) + "'";
+                return false;
+            }
+            return true;
+        }
+
+        // Returns false at the end of the file or if the line could not be parsed, in
+        // which case 'error' is set
+        bool next() {
+            while (std::getline(file, line)) {
+                iLine += 1;
+                nBytesRead += line.size() + 1;
+                if (line.find_first_not_of(' ') == std::string::npos)  continue;
+
+                size_t typeBegin = line.find_first_not_of(' ');
+                size_t typeEnd = line.find(' ', typeBegin);
+                type = std::string_view(line).substr(typeBegin, typeEnd - typeBegin);
+
+                size_t pos = typeEnd;
+                double* times[] = { &startupTime, &recordingTime, &ingameTime };
+                for (double* t : times) {
+                    pos = line.find_first_not_of(' ', pos);
+                    if (pos == std::string::npos) {
+                        error = "Too few values in line " + std::to_string(iLine) +
+                            " of '" + path.string() + "'";
+                        return false;
+                    }
+                    std::from_chars_result res = std::from_chars(
+                        line.data() + pos, line.data() + line.size(), *t
+                    );
+                    if (res.ec != std::errc()) {
+                        error = "Invalid time value in line " + std::to_string(iLine) +
+                            " of '" + path.string() + "'";
+                        return false;
+                    }
+                    pos = res.ptr - line.data();
+                }
+                payload = pos < line.size() ? line.find_first_not_of(' ', pos) : pos;
+                if (payload == std::string::npos)  payload = line.size();
+                return true;
+            }
+            return false;
+        }
+
+        std::filesystem::path path;
+        std::vector<char> streamBuffer;
+        std::ifstream file;
+
+        std::string line;
+        int iLine = 1;
+        std::string_view type;
+        double startupTime = 0.0;
+        double recordingTime = 0.0;
+        double ingameTime = 0.0;
+        // Start of everything in the line that follows the time values
+        size_t payload = 0;
+
+        std::string error;
+        size_t nBytesRead = 0;
+    };
 } // namespace
 
 SessionRecording* loadSessionRecording(std::filesystem::path path) {
+    ScopedTimer timer("loadSessionRecording");
     SessionRecording* res = new SessionRecording;
-    res->minMaxScale = std::pair(std::numeric_limits<double>::max(), -std::numeric_limits<double>::max());
 
     std::ifstream f(path);
     std::string line;
     std::getline(f, line);
     if (line != "OpenSpace_record/playback01.00A") {
-        QMessageBox::critical(nullptr, "Error loading session recording",
+        reportError("Error loading session recording",
             "Could not load session recording. "
             "Header is not 'OpenSpace_record/playback01.00A'"
         );
@@ -50,21 +227,35 @@ SessionRecording* loadSessionRecording(std::filesystem::path path) {
         return nullptr;
     }
 
+    size_t nBytesRead = line.size() + 1;
     int iLine = 1;
     while (std::getline(f, line)) {
+        iLine += 1;
+        nBytesRead += line.size() + 1;
         std::vector<std::string> parts = tokenizeString(line, ' ');
         removeEmpty(&parts);
+        if (parts.empty())  continue;
 
         std::string type = parts[0];
         if (type != "script" && type != "camera") {
-            QMessageBox::critical(nullptr, "Error loading session recording",
-                QString::fromStdString("Could not load session recording. "
-                "Unknown keyframe type '" + type + "' in line " + std::to_string(iLine))
+            reportError("Error loading session recording",
+                "Could not load session recording. "
+                "Unknown keyframe type '" + type + "' in line " + std::to_string(iLine)
             );
             delete res;
             return nullptr;
         }
 
+        const size_t nRequiredParts = type == "camera" ? 14 : 5;
+        if (parts.size() < nRequiredParts) {
+            reportError("Error loading session recording",
+                "Could not load session recording. "
+                "Expected " + std::to_string(nRequiredParts) + " values, got " +
+                std::to_string(parts.size()) + " in line " + std::to_string(iLine)
+            );
+            delete res;
+            return nullptr;
+        }
 
         if (type == "script") {
             KeyframeScript* kf = new KeyframeScript;
@@ -73,14 +264,23 @@ SessionRecording* loadSessionRecording(std::filesystem::path path) {
             kf->recordingTime = std::atof(parts[2].c_str());
             kf->ingameTime = std::atof(parts[3].c_str());
             if (parts[4] != "1") {
-                QMessageBox::critical(nullptr, "Error loading session recording",
-                    QString::fromStdString("Could not load session recording. "
-                        "Can only understand script keyframes with 1 script, got '" + parts[4] + "' in line" + std::to_string(iLine))
+                reportError("Error loading session recording",
+                    "Could not load session recording. "
+                    "Can only understand script keyframes with 1 script, got '" + parts[4] + "' in line" + std::to_string(iLine)
                 );
                 delete res;
                 return nullptr;
             }
-            kf->script = std::accumulate(parts.begin() + 5, parts.end(), std::string());
+            // The script can contain spaces itself, so it is the rest of the line after the
+            // script count rather than the remaining parts
+            size_t scriptBegin = 0;
+            for (int i = 0; i < 5 && scriptBegin != std::string::npos; i += 1) {
+                scriptBegin = line.find(' ', line.find_first_not_of(' ', scriptBegin));
+            }
+            if (scriptBegin != std::string::npos) {
+                scriptBegin = line.find_first_not_of(' ', scriptBegin);
+            }
+            if (scriptBegin != std::string::npos)  kf->script = line.substr(scriptBegin);
             res->keyframes.push_back(kf);
         }
         else {
@@ -101,97 +301,340 @@ SessionRecording* loadSessionRecording(std::filesystem::path path) {
             kf->shouldFollow = parts[12] == "F";
             kf->followNode = parts[13];
             res->keyframes.push_back(kf);
-
-            if (kf->scale < res->minMaxScale.first)  res->minMaxScale.first = kf->scale;
-            if (kf->scale > res->minMaxScale.second)  res->minMaxScale.second = kf->scale;
         }
     }
+    addToCounter(Counter::BytesRead, nBytesRead);
+    addToCounter(Counter::LinesParsed, static_cast<size_t>(iLine));
+    addToCounter(Counter::KeyframesAllocated, res->keyframes.size());
+
+    if (!normalizeSessionRecording(res)) {
+        reportError("Error loading session recording",
+            "Could not load session recording. "
+            "After normalization, less than two camera keyframes are left"
+        );
+        delete res;
+        return nullptr;
+    }
+
+    return res;
+}
+
+bool normalizeSessionRecording(SessionRecording* session) {
+    ScopedTimer timer("normalizeSessionRecording");
+    session->curveTimes.clear();
+    session->curveKeyframes.clear();
+    if (session->keyframes.empty())  return false;
 
     // Recording length
-    res->recordingLength = res->keyframes.back()->recordingTime;
+    session->recordingLength = session->keyframes.back()->recordingTime;
 
-    // create scale normalization
-    for (Keyframe* k : res->keyframes) {
+    // create time normalization. The times are gathered first so that the normalization is
+    // a separate loop over a contiguous array
+    for (Keyframe* k : session->keyframes) {
         if (k->type != Keyframe::Type::Camera)  continue;
 
         KeyframeCamera* kf = static_cast<KeyframeCamera*>(k);
-        double x = kf->recordingTime / res->recordingLength;
-        double y = (kf->scale - res->minMaxScale.first) / (res->minMaxScale.second - res->minMaxScale.first);
+        session->curveTimes.push_back(kf->recordingTime);
+        session->curveKeyframes.push_back(kf);
+    }
+    const double length = session->recordingLength;
+    for (double& t : session->curveTimes) {
+        t /= length;
+    }
+
+    // The channels are independent of each other, so they are created in parallel
+    ScopedTimer linearizeTimer("linearizeCurves");
+    parallelForChunks(NumberOfChannels, parallelChunkCount(NumberOfChannels, 1),
+        [session](size_t, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i += 1) {
+                updateChannelCurve(session, static_cast<Channel>(i));
+            }
+        }
+    );
 
-        ScaleInfo info;
-        info.x = x;
-        info.y = y;
-        info.kf = kf;
-        res->normalizedLinearizedScale.push_back(info);
+    session->scriptIndex = createScriptIndex(session->keyframes);
+
+    return session->curveKeyframes.size() >= 2;
+}
+
+void updateChannelCurve(SessionRecording* session, Channel channel) {
+    std::vector<double> values;
+    values.reserve(session->curveKeyframes.size());
+    for (const KeyframeCamera* kf : session->curveKeyframes) {
+        values.push_back(channelValue(kf, channel));
+    }
+    session->curve(channel) = createChannelCurve(std::move(values), session->curveTimes);
+}
+
+void retimeSessionRecording(SessionRecording* session, double begin, double end,
+                            double speed)
+{
+    assert(begin <= end);
+    assert(speed > 0.0);
+
+    // The keyframes are separate allocations, so their times are gathered into a contiguous
+    // array first. The remapping itself is then a branch-free loop that is vectorized
+    const size_t n = session->keyframes.size();
+    std::vector<double> offsets(n);
+    for (size_t i = 0; i < n; i += 1) {
+        offsets[i] = session->keyframes[i]->recordingTime;
+    }
+    for (size_t i = 0; i < n; i += 1) {
+        // Only the part of the time that lies within the range is scaled, everything after
+        // the range is shifted by the full difference in duration
+        double inRange = std::min(std::max(offsets[i], begin), end) - begin;
+        offsets[i] = inRange / speed - inRange;
     }
-    res->originalNormalizedScale = res->normalizedLinearizedScale;
 
-    // remove keyframes that are represented by linear interpolation
-    for (size_t i = 1; i < res->normalizedLinearizedScale.size() - 1; i += 1) {
-        const ScaleInfo& before = res->normalizedLinearizedScale[i - 1];
-        const ScaleInfo& current = res->normalizedLinearizedScale[i];
-        const ScaleInfo& after = res->normalizedLinearizedScale[i + 1];
+    // The startup time runs in lockstep with the recording time, so it receives the same
+    // offset. The ingame time is left untouched, which means that the simulation time runs
+    // faster or slower through the retimed range
+    for (size_t i = 0; i < n; i += 1) {
+        session->keyframes[i]->recordingTime += offsets[i];
+        session->keyframes[i]->startupTime += offsets[i];
+    }
+
+    normalizeSessionRecording(session);
+}
+
+bool cutSessionRecording(SessionRecording* session, double begin, double end) {
+    assert(begin <= end);
 
-        double t = (current.x - before.x) / (after.x - before.x);
-        double v = before.y + t * (after.y - before.y);
+    auto isCut = [begin, end](Keyframe* kf) {
+        return kf->recordingTime >= begin && kf->recordingTime < end;
+    };
 
-        constexpr const double Epsilon = 1e-4;
-        if (abs(v - current.y) <= Epsilon || (after.y == before.y)) {
-            res->normalizedLinearizedScale.erase(res->normalizedLinearizedScale.begin() + i);
-            i -= 1;
+    // Cutting must not remove the camera keyframes that define the curves
+    size_t nRemainingCameras = std::count_if(
+        session->keyframes.begin(), session->keyframes.end(),
+        [&isCut](Keyframe* kf) { return kf->type == Keyframe::Type::Camera && !isCut(kf); }
+    );
+    if (nRemainingCameras < 2)  return false;
+
+    const double shift = end - begin;
+    std::vector<Keyframe*> remaining;
+    remaining.reserve(session->keyframes.size());
+    for (Keyframe* kf : session->keyframes) {
+        if (isCut(kf)) {
+            deleteKeyframe(kf);
+            continue;
+        }
+
+        if (kf->recordingTime >= end) {
+            kf->recordingTime -= shift;
+            kf->startupTime -= shift;
         }
+        remaining.push_back(kf);
     }
+    session->keyframes = std::move(remaining);
 
-    if (res->normalizedLinearizedScale.size() < 2) {
-        QMessageBox::critical(nullptr, "Error loading session recording",
-            QString::fromStdString("Could not load session recording. "
-                "After normalization, less than two scale values are left")
-        );
-        delete res;
-        return nullptr;
+    return normalizeSessionRecording(session);
+}
+
+void deleteSessionRecording(SessionRecording* session) {
+    if (!session)  return;
+
+    for (Keyframe* kf : session->keyframes) {
+        deleteKeyframe(kf);
     }
+    delete session;
+}
 
-    return res;
+void setHeadless(bool headless) {
+    IsHeadless = headless;
 }
 
-void saveSessionRecording(SessionRecording* session, std::filesystem::path path) {
-    std::ofstream f(path);
-    if (!f.good()) {
-        QMessageBox::critical(nullptr, "Error loading session recording",
-            QString::fromStdString("Could not save session recording. Path incorrect?")
+bool saveSessionRecording(SessionRecording* session, std::filesystem::path path) {
+    ScopedTimer timer("saveSessionRecording");
+    RecordingWriter writer(path);
+    if (!writer.file.good()) {
+        reportError("Error saving session recording",
+            "Could not save session recording. Path incorrect?"
         );
+        return false;
     }
-    f.precision(20);
-    f << std::fixed;
 
-    f << "OpenSpace_record/playback01.00A\n";
+    // Lines are formatted into the writer's buffer instead of going through the
+    // formatted stream operators for every single value
+    std::string& buffer = writer.buffer;
+    buffer += Header;
+    buffer += '\n';
     for (Keyframe* v : session->keyframes) {
         if (v->type == Keyframe::Type::Camera) {
             KeyframeCamera* kf = static_cast<KeyframeCamera*>(v);
 
-            f << "camera ";
-            f << kf->startupTime << ' ';
-            f << kf->recordingTime << ' ';
-            f << kf->ingameTime << ' ';
-            f << kf->posX << ' ';
-            f << kf->posY << ' ';
-            f << kf->posZ << ' ';
-            f << kf->orientationW << ' ';
-            f << kf->orientationX << ' ';
-            f << kf->orientationY << ' ';
-            f << kf->orientationZ << ' ';
-            f << kf->scale << ' ';
-            f << (kf->shouldFollow ? "F" : "-") << ' ';
-            f << kf->followNode << '\n';
+            buffer += "camera ";
+            appendValue(buffer, kf->startupTime);
+            appendValue(buffer, kf->recordingTime);
+            appendValue(buffer, kf->ingameTime);
+            appendValue(buffer, kf->posX);
+            appendValue(buffer, kf->posY);
+            appendValue(buffer, kf->posZ);
+            appendValue(buffer, kf->orientationW);
+            appendValue(buffer, kf->orientationX);
+            appendValue(buffer, kf->orientationY);
+            appendValue(buffer, kf->orientationZ);
+            appendValue(buffer, kf->scale);
+            buffer += kf->shouldFollow ? "F " : "- ";
+            buffer += kf->followNode;
+            buffer += '\n';
         }
         else {
             KeyframeScript* kf = static_cast<KeyframeScript*>(v);
-            f << "script ";
-            f << kf->startupTime << ' ';
-            f << kf->recordingTime << ' ';
-            f << kf->ingameTime << ' ';
-            f << "1 ";
-            f << kf->script << '\n';
+            buffer += "script ";
+            appendValue(buffer, kf->startupTime);
+            appendValue(buffer, kf->recordingTime);
+            appendValue(buffer, kf->ingameTime);
+            buffer += "1 ";
+            buffer += kf->script;
+            buffer += '\n';
         }
+
+        writer.flushIfFull();
+    }
+
+    writer.flush();
+    writer.file.close();
+    if (!writer.file.good()) {
+        reportError("Error saving session recording",
+            "Could not write the whole session recording. Disk full?"
+        );
+        return false;
+    }
+    return true;
+}
+
+bool concatenateSessionRecordings(const std::vector<std::filesystem::path>& inputs,
+                                  std::filesystem::path output)
+{
+    TemporaryOutput temporary(output);
+    RecordingWriter writer(temporary.temporary);
+    if (!writer.file.good()) {
+        reportError("Error concatenating session recordings",
+            "Could not write to '" + output.string() + "'. Path incorrect?"
+        );
+        return false;
+    }
+    writer.buffer += Header;
+    writer.buffer += '\n';
+
+    // End times of everything that has been written so far. Each following recording is
+    // shifted so that it starts one frame after the previous one ended, using the last
+    // keyframe spacing of the previous recording as the length of that frame
+    double lastStartupTime = 0.0;
+    double lastRecordingTime = 0.0;
+    double lastSpacing = DefaultFrameSpacing;
+    bool hasWritten = false;
+    for (const std::filesystem::path& input : inputs) {
+        RecordingReader reader(input);
+        if (!reader.readHeader()) {
+            reportError("Error concatenating session recordings", reader.error);
+            return false;
+        }
+
+        double startupOffset = 0.0;
+        double recordingOffset = 0.0;
+        bool isFirst = true;
+        while (reader.next()) {
+            if (isFirst && hasWritten) {
+                startupOffset = lastStartupTime + lastSpacing - reader.startupTime;
+                recordingOffset = lastRecordingTime + lastSpacing - reader.recordingTime;
+            }
+            else if (!isFirst && reader.recordingTime + recordingOffset > lastRecordingTime) {
+                lastSpacing = reader.recordingTime + recordingOffset - lastRecordingTime;
+            }
+            isFirst = false;
+
+            lastStartupTime = reader.startupTime + startupOffset;
+            lastRecordingTime = reader.recordingTime + recordingOffset;
+
+            writer.buffer += reader.type;
+            writer.buffer += ' ';
+            appendValue(writer.buffer, lastStartupTime);
+            appendValue(writer.buffer, lastRecordingTime);
+            appendValue(writer.buffer, reader.ingameTime);
+            writer.buffer.append(reader.line, reader.payload);
+            writer.buffer += '\n';
+            writer.flushIfFull();
+            hasWritten = true;
+        }
+        if (!reader.error.empty()) {
+            reportError("Error concatenating session recordings", reader.error);
+            return false;
+        }
+    }
+
+    if (!temporary.commit(writer)) {
+        reportError("Error concatenating session recordings",
+            "Could not write to '" + output.string() + "'. Disk full?"
+        );
+        return false;
+    }
+    return true;
+}
+
+bool mergeSessionRecordings(const std::vector<std::filesystem::path>& inputs,
+                            std::filesystem::path output)
+{
+    // Only the current line of each input is kept in memory, so the memory use depends
+    // on the number of inputs, but not on their size
+    std::vector<std::unique_ptr<RecordingReader>> readers;
+    for (const std::filesystem::path& input : inputs) {
+        readers.push_back(std::make_unique<RecordingReader>(input));
+        if (!readers.back()->readHeader()) {
+            reportError("Error merging session recordings", readers.back()->error);
+            return false;
+        }
+    }
+
+    TemporaryOutput temporary(output);
+    RecordingWriter writer(temporary.temporary);
+    if (!writer.file.good()) {
+        reportError("Error merging session recordings",
+            "Could not write to '" + output.string() + "'. Path incorrect?"
+        );
+        return false;
+    }
+    writer.buffer += Header;
+    writer.buffer += '\n';
+
+    // Min-heap over the readers' current recording time. Ties are broken by the input
+    // order so that keyframes at the same time keep a stable order
+    auto isLater = [&readers](size_t lhs, size_t rhs) {
+        double lhsTime = readers[lhs]->recordingTime;
+        double rhsTime = readers[rhs]->recordingTime;
+        return lhsTime > rhsTime || (lhsTime == rhsTime && lhs > rhs);
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(isLater)> queue(isLater);
+    for (size_t i = 0; i < readers.size(); i += 1) {
+        if (readers[i]->next())  queue.push(i);
+    }
+
+    while (!queue.empty()) {
+        size_t i = queue.top();
+        queue.pop();
+
+        RecordingReader& reader = *readers[i];
+        writer.buffer += reader.line;
+        writer.buffer += '\n';
+        writer.flushIfFull();
+
+        if (reader.next())  queue.push(i);
+    }
+
+    for (const std::unique_ptr<RecordingReader>& reader : readers) {
+        if (!reader->error.empty()) {
+            reportError("Error merging session recordings", reader->error);
+            return false;
+        }
+    }
+
+    readers.clear();
+    if (!temporary.commit(writer)) {
+        reportError("Error merging session recordings",
+            "Could not write to '" + output.string() + "'. Disk full?"
+        );
+        return false;
     }
+    return true;
 }
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "curve.h"
+#include "scriptindex.h"
 #include <filesystem>
+#include <string>
 #include <variant>
 #include <vector>
 
@@ -37,21 +40,56 @@ struct KeyframeScript : public Keyframe {
     std::string script;
 };
 
-struct ScaleInfo {
-    double x;
-    double y;
-    KeyframeCamera* kf;
-};
-
 struct SessionRecording {
+    ChannelCurve& curve(Channel channel) { return curves[static_cast<size_t>(channel)]; }
+    const ChannelCurve& curve(Channel channel) const {
+        return curves[static_cast<size_t>(channel)];
+    }
+
     std::vector<Keyframe*> keyframes;
 
     double recordingLength = 0.0;
-    std::pair<double, double> minMaxScale;
 
-    std::vector<ScaleInfo> originalNormalizedScale;
-    std::vector<ScaleInfo> normalizedLinearizedScale;
+    // One entry per camera keyframe, shared by all channel curves
+    std::vector<double> curveTimes;
+    std::vector<KeyframeCamera*> curveKeyframes;
+    std::array<ChannelCurve, NumberOfChannels> curves;
+
+    ScriptIndex scriptIndex;
 };
 
 SessionRecording* loadSessionRecording(std::filesystem::path path);
-void saveSessionRecording(SessionRecording* session, std::filesystem::path path);
+bool saveSessionRecording(SessionRecording* session, std::filesystem::path path);
+
+// Frees the recording together with all of its keyframes
+void deleteSessionRecording(SessionRecording* session);
+
+// Recomputes the recording length, all channel curves, and the script index from the
+// keyframes. Returns false if fewer than two camera keyframes are left
+bool normalizeSessionRecording(SessionRecording* session);
+
+// Recomputes a single channel curve after the channel was changed in the keyframes
+void updateChannelCurve(SessionRecording* session, Channel channel);
+
+// Plays the recording time range [begin, end) back with the provided speed factor and
+// shifts all later keyframes to match
+void retimeSessionRecording(SessionRecording* session, double begin, double end,
+    double speed);
+
+// Removes all keyframes in the recording time range [begin, end) and shifts all later
+// keyframes to close the gap. Returns false if the cut would leave too few keyframes
+bool cutSessionRecording(SessionRecording* session, double begin, double end);
+
+// Streams the inputs one after another into the output file. Each recording is shifted in
+// time to start where the previous one ended. The output is only replaced once it is
+// complete, so it can also be one of the inputs
+bool concatenateSessionRecordings(const std::vector<std::filesystem::path>& inputs,
+    std::filesystem::path output);
+
+// Streams the keyframes of all inputs into the output file ordered by their recording time.
+// Like for concatenation, the output can also be one of the inputs
+bool mergeSessionRecordings(const std::vector<std::filesystem::path>& inputs,
+    std::filesystem::path output);
+
+// In headless mode, errors are written to the console instead of being shown in a dialog
+void setHeadless(bool headless);
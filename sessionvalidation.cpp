@@ -0,0 +1,377 @@
+#include "sessionvalidation.h"
+
+#include "parallel.h"
+#include "profiling.h"
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+
+const std::array<const char*, 11> ValidationReport::ChannelNames = {
+    "startupTime", "recordingTime", "ingameTime", "posX", "posY", "posZ",
+    "orientationW", "orientationX", "orientationY", "orientationZ", "scale"
+};
+
+const std::array<double, 7> ValidationReport::SpacingBins = {
+    1e-4, 1e-3, 1e-2, 1e-1, 1.0, 10.0, 100.0
+};
+
+namespace {
+    constexpr const std::string_view Header = "OpenSpace_record/playback01.00A";
+
+    // Indices into ValidationReport::channels
+    constexpr const int RecordingTime = 1;
+    constexpr const int OrientationW = 6;
+
+    // Everything that is computed for a single chunk of lines. Line numbers of the
+    // issues are relative to the beginning of the chunk until they are merged
+    struct ChunkResult {
+        size_t nLines = 0;
+        size_t nCameras = 0;
+        size_t nScripts = 0;
+
+        std::array<size_t, ValidationIssue::NumberOfKinds> issueCounts = {};
+        std::vector<ValidationIssue> issues;
+
+        std::array<size_t, 8> spacingHistogram = {};
+        ChannelStatistics spacing;
+        std::array<ChannelStatistics, 11> channels;
+
+        bool hasTime = false;
+        double firstTime = 0.0;
+        size_t firstTimeLine = 0;
+        double lastTime = 0.0;
+    };
+
+    void update(ChannelStatistics& stats, double value) {
+        stats.min = std::min(stats.min, value);
+        stats.max = std::max(stats.max, value);
+    }
+
+    void update(ChannelStatistics& stats, const ChannelStatistics& other) {
+        stats.min = std::min(stats.min, other.min);
+        stats.max = std::max(stats.max, other.max);
+    }
+
+    size_t spacingBin(double spacing) {
+        const std::array<double, 7>& bins = ValidationReport::SpacingBins;
+        return std::upper_bound(bins.begin(), bins.end(), spacing) - bins.begin();
+    }
+
+    void addIssue(ChunkResult& res, const ValidationOptions& options,
+                  ValidationIssue::Kind kind, size_t line, std::string message)
+    {
+        res.issueCounts[static_cast<size_t>(kind)] += 1;
+        if (res.issues.size() < options.maxStoredIssues) {
+            res.issues.push_back({ kind, line, std::move(message) });
+        }
+    }
+
+    // Checks the spacing between two consecutive recording times
+    void checkSpacing(ChunkResult& res, const ValidationOptions& options, double previous,
+                      double current, size_t line)
+    {
+        if (current < previous) {
+            addIssue(res, options, ValidationIssue::Kind::NonMonotonicTime, line,
+                "Recording time " + std::to_string(current) + " is before the previous " +
+                std::to_string(previous)
+            );
+            return;
+        }
+
+        double spacing = current - previous;
+        res.spacingHistogram[spacingBin(spacing)] += 1;
+        update(res.spacing, spacing);
+        // Playback would jump between both keyframes without any time passing
+        if (spacing == 0.0) {
+            addIssue(res, options, ValidationIssue::Kind::EqualTime, line,
+                "Recording time " + std::to_string(current) + " is the same as the previous"
+            );
+        }
+        if (spacing > options.largeTimeGap) {
+            addIssue(res, options, ValidationIssue::Kind::LargeTimeGap, line,
+                "Gap of " + std::to_string(spacing) + " seconds"
+            );
+        }
+    }
+
+    void validateChunk(std::string_view data, const ValidationOptions& options,
+                       ChunkResult& res)
+    {
+        std::array<std::string_view, 14> tokens;
+        std::array<double, 11> values;
+
+        size_t lineBegin = 0;
+        while (lineBegin < data.size()) {
+            size_t lineEnd = data.find('\n', lineBegin);
+            if (lineEnd == std::string_view::npos)  lineEnd = data.size();
+            std::string_view line = data.substr(lineBegin, lineEnd - lineBegin);
+            lineBegin = lineEnd + 1;
+
+            const size_t iLine = res.nLines;
+            res.nLines += 1;
+
+            if (!line.empty() && line.back() == '\r')  line.remove_suffix(1);
+
+            size_t nTokens = 0;
+            size_t pos = line.find_first_not_of(' ');
+            while (pos != std::string_view::npos && nTokens < tokens.size()) {
+                size_t end = line.find(' ', pos);
+                if (end == std::string_view::npos)  end = line.size();
+                tokens[nTokens] = line.substr(pos, end - pos);
+                nTokens += 1;
+                pos = line.find_first_not_of(' ', end);
+            }
+            if (nTokens == 0)  continue;
+
+            size_t nValues = 0;
+            size_t nRequiredTokens = 0;
+            if (tokens[0] == "camera") {
+                nValues = 11;
+                nRequiredTokens = 14;
+            }
+            else if (tokens[0] == "script") {
+                nValues = 3;
+                nRequiredTokens = 5;
+            }
+            else {
+                addIssue(res, options, ValidationIssue::Kind::UnknownType, iLine,
+                    "Unknown keyframe type '" + std::string(tokens[0]) + "'"
+                );
+                continue;
+            }
+
+            if (nTokens < nRequiredTokens) {
+                addIssue(res, options, ValidationIssue::Kind::ShortLine, iLine,
+                    "Expected " + std::to_string(nRequiredTokens) + " values, got " +
+                    std::to_string(nTokens)
+                );
+                continue;
+            }
+
+            bool hasInvalidValue = false;
+            for (size_t i = 0; i < nValues; i += 1) {
+                std::string_view token = tokens[i + 1];
+                std::from_chars_result r = std::from_chars(
+                    token.data(), token.data() + token.size(), values[i]
+                );
+                if (r.ec != std::errc() || !std::isfinite(values[i])) {
+                    addIssue(res, options, ValidationIssue::Kind::InvalidValue, iLine,
+                        "Invalid " + std::string(ValidationReport::ChannelNames[i]) +
+                        " value '" + std::string(token) + "'"
+                    );
+                    hasInvalidValue = true;
+                    break;
+                }
+            }
+            if (hasInvalidValue)  continue;
+
+            // The loader only accepts script keyframes that contain a single script
+            if (nValues == 3 && tokens[4] != "1") {
+                addIssue(res, options, ValidationIssue::Kind::InvalidValue, iLine,
+                    "Expected 1 script, got '" + std::string(tokens[4]) + "'"
+                );
+                continue;
+            }
+
+            if (nValues == 11) {
+                res.nCameras += 1;
+
+                double w = values[OrientationW];
+                double x = values[OrientationW + 1];
+                double y = values[OrientationW + 2];
+                double z = values[OrientationW + 3];
+                double length = std::sqrt(w * w + x * x + y * y + z * z);
+                if (std::abs(length - 1.0) > options.quaternionTolerance) {
+                    addIssue(res, options, ValidationIssue::Kind::NonUnitQuaternion, iLine,
+                        "Orientation has length " + std::to_string(length)
+                    );
+                }
+            }
+            else {
+                res.nScripts += 1;
+            }
+
+            for (size_t i = 0; i < nValues; i += 1) {
+                update(res.channels[i], values[i]);
+            }
+
+            double time = values[RecordingTime];
+            if (res.hasTime) {
+                checkSpacing(res, options, res.lastTime, time, iLine);
+            }
+            else {
+                res.hasTime = true;
+                res.firstTime = time;
+                res.firstTimeLine = iLine;
+            }
+            res.lastTime = time;
+        }
+    }
+} // namespace
+
+bool ValidationReport::isValid() const {
+    if (!hasValidHeader)  return false;
+    for (size_t i = 0; i < issueCounts.size(); i += 1) {
+        // Large time gaps are suspicious, but the recording can still be loaded
+        if (static_cast<ValidationIssue::Kind>(i) == ValidationIssue::Kind::LargeTimeGap) {
+            continue;
+        }
+        if (issueCounts[i] > 0)  return false;
+    }
+    return true;
+}
+
+ValidationReport validateSessionRecording(std::filesystem::path path,
+                                          const ValidationOptions& options)
+{
+    ScopedTimer timer("validateSessionRecording");
+    ValidationReport report;
+
+    std::string content;
+    {
+        // Directories and other files without a size cannot be validated
+        std::error_code ec;
+        std::uintmax_t size = std::filesystem::file_size(path, ec);
+        if (ec)  return report;
+
+        std::ifstream f(path, std::ifstream::binary);
+        if (!f.good())  return report;
+        content.resize(static_cast<size_t>(size));
+        f.read(content.data(), content.size());
+        if (static_cast<size_t>(f.gcount()) != content.size())  return report;
+    }
+    report.isReadable = true;
+
+    std::string_view data = content;
+    size_t headerEnd = data.find('\n');
+    std::string_view header = data.substr(0, headerEnd);
+    if (!header.empty() && header.back() == '\r')  header.remove_suffix(1);
+    report.hasValidHeader = header == Header;
+    if (!report.hasValidHeader || headerEnd == std::string_view::npos)  return report;
+    data.remove_prefix(headerEnd + 1);
+
+    // Split the file into chunks that each end at a line break
+    const size_t nChunks = parallelChunkCount(data.size(), 1024 * 1024);
+    std::vector<size_t> boundaries = { 0 };
+    for (size_t i = 1; i < nChunks; i += 1) {
+        size_t pos = data.find('\n', std::max(i * data.size() / nChunks, boundaries.back()));
+        if (pos == std::string_view::npos)  break;
+        boundaries.push_back(pos + 1);
+    }
+    boundaries.push_back(data.size());
+
+    std::vector<ChunkResult> chunks(boundaries.size() - 1);
+    parallelForChunks(chunks.size(), chunks.size(),
+        [&](size_t chunk, size_t, size_t) {
+            std::string_view d = data.substr(
+                boundaries[chunk], boundaries[chunk + 1] - boundaries[chunk]
+            );
+            validateChunk(d, options, chunks[chunk]);
+        }
+    );
+
+    // Reduce the chunks in order so that the line numbers and the checks across the
+    // chunk boundaries can be resolved. The first line of the data is line 2
+    ChunkResult boundaryChecks;
+    size_t lineOffset = 2;
+    const ChunkResult* previous = nullptr;
+    for (ChunkResult& chunk : chunks) {
+        if (chunk.hasTime && previous) {
+            boundaryChecks.issues.clear();
+            checkSpacing(
+                boundaryChecks, options, previous->lastTime, chunk.firstTime,
+                chunk.firstTimeLine
+            );
+            chunk.issues.insert(
+                chunk.issues.begin(),
+                boundaryChecks.issues.begin(), boundaryChecks.issues.end()
+            );
+        }
+
+        report.nLines += chunk.nLines;
+        report.nCameras += chunk.nCameras;
+        report.nScripts += chunk.nScripts;
+        for (size_t i = 0; i < report.issueCounts.size(); i += 1) {
+            report.issueCounts[i] += chunk.issueCounts[i];
+        }
+        for (ValidationIssue& issue : chunk.issues) {
+            if (report.issues.size() >= options.maxStoredIssues)  break;
+            issue.line += lineOffset;
+            report.issues.push_back(std::move(issue));
+        }
+        for (size_t i = 0; i < report.spacingHistogram.size(); i += 1) {
+            report.spacingHistogram[i] += chunk.spacingHistogram[i];
+        }
+        update(report.spacing, chunk.spacing);
+        for (size_t i = 0; i < report.channels.size(); i += 1) {
+            update(report.channels[i], chunk.channels[i]);
+        }
+
+        lineOffset += chunk.nLines;
+        if (chunk.hasTime)  previous = &chunk;
+    }
+    for (size_t i = 0; i < report.issueCounts.size(); i += 1) {
+        report.issueCounts[i] += boundaryChecks.issueCounts[i];
+    }
+    for (size_t i = 0; i < report.spacingHistogram.size(); i += 1) {
+        report.spacingHistogram[i] += boundaryChecks.spacingHistogram[i];
+    }
+    update(report.spacing, boundaryChecks.spacing);
+
+    return report;
+}
+
+std::string validationSummary(const ValidationReport& report) {
+    constexpr const std::array<const char*, ValidationIssue::NumberOfKinds> IssueNames = {
+        "Short lines", "Unknown keyframe types", "Invalid values",
+        "Non-unit quaternions", "Non-monotonic recording times", "Equal recording times",
+        "Large time gaps (warning)"
+    };
+
+    std::ostringstream s;
+    if (!report.isReadable) {
+        s << "Could not read file\n";
+        return s.str();
+    }
+    if (!report.hasValidHeader) {
+        s << "Header is not '" << Header << "'\n";
+        return s.str();
+    }
+
+    s << "Lines: " << report.nLines << " (" << report.nCameras << " camera, "
+        << report.nScripts << " script)\n";
+
+    s << "\nIssues:\n";
+    for (size_t i = 0; i < report.issueCounts.size(); i += 1) {
+        s << "  " << IssueNames[i] << ": " << report.issueCounts[i] << '\n';
+    }
+    for (const ValidationIssue& issue : report.issues) {
+        s << "  Line " << issue.line << ": " << issue.message << '\n';
+    }
+
+    s << "\nKeyframe spacing:\n";
+    if (report.spacing.min <= report.spacing.max) {
+        s << "  min " << report.spacing.min << ", max " << report.spacing.max << '\n';
+    }
+    for (size_t i = 0; i < report.spacingHistogram.size(); i += 1) {
+        if (i < ValidationReport::SpacingBins.size()) {
+            s << "  < " << ValidationReport::SpacingBins[i];
+        }
+        else {
+            s << "  >= " << ValidationReport::SpacingBins.back();
+        }
+        s << ": " << report.spacingHistogram[i] << '\n';
+    }
+
+    s << "\nChannels:\n";
+    for (size_t i = 0; i < report.channels.size(); i += 1) {
+        const ChannelStatistics& c = report.channels[i];
+        if (c.min > c.max)  continue;
+        s << "  " << ValidationReport::ChannelNames[i] << ": " << c.min << " - " << c.max
+            << '\n';
+    }
+
+    return s.str();
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <vector>
+
+struct ValidationOptions {
+    // Consecutive keyframes further apart than this (in seconds) are reported
+    double largeTimeGap = 1.0;
+    // Allowed deviation of the quaternion length from 1
+    double quaternionTolerance = 1e-3;
+    // Only this many issues are stored; all of them are counted
+    size_t maxStoredIssues = 1000;
+};
+
+struct ValidationIssue {
+    enum class Kind {
+        ShortLine = 0,
+        UnknownType,
+        InvalidValue,
+        NonUnitQuaternion,
+        NonMonotonicTime,
+        EqualTime,
+        LargeTimeGap
+    };
+    static constexpr const size_t NumberOfKinds = 7;
+
+    Kind kind;
+    size_t line;
+    std::string message;
+};
+
+struct ChannelStatistics {
+    double min = std::numeric_limits<double>::max();
+    double max = -std::numeric_limits<double>::max();
+};
+
+struct ValidationReport {
+    // Names of the channels in the same order as 'channels'
+    static const std::array<const char*, 11> ChannelNames;
+    // Upper bounds of the keyframe spacing histogram bins in seconds; the last bin
+    // collects everything that is larger
+    static const std::array<double, 7> SpacingBins;
+
+    // False if the file does not exist or could not be read, nothing else is checked then
+    bool isReadable = false;
+    bool hasValidHeader = false;
+    size_t nLines = 0;
+    size_t nCameras = 0;
+    size_t nScripts = 0;
+
+    std::array<size_t, ValidationIssue::NumberOfKinds> issueCounts = {};
+    std::vector<ValidationIssue> issues;
+
+    std::array<size_t, 8> spacingHistogram = {};
+    ChannelStatistics spacing;
+    std::array<ChannelStatistics, 11> channels;
+
+    // Returns false if the recording has any issues. Large time gaps are only warnings
+    bool isValid() const;
+};
+
+ValidationReport validateSessionRecording(std::filesystem::path path,
+    const ValidationOptions& options);
+
+std::string validationSummary(const ValidationReport& report);